@@ -0,0 +1,75 @@
+#version 450
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (set = 0, binding = 0) uniform sampler2D drawImage;
+layout (set = 0, binding = 1) uniform sampler2D backgroundImage;
+
+layout( push_constant ) uniform constants
+{
+	vec2 uvScale;
+	float exposure;
+	uint tonemapper;
+	float ditherStrength;
+	uint frame;
+} PushConstants;
+
+vec3 reinhard(vec3 color)
+{
+	return color / (1.0f + color);
+}
+
+// Narkowicz ACES fit
+vec3 aces(vec3 color)
+{
+	const float a = 2.51f;
+	const float b = 0.03f;
+	const float c = 2.43f;
+	const float d = 0.59f;
+	const float e = 0.14f;
+	return clamp((color * (a * color + b)) / (color * (c * color + d) + e), 0.0f, 1.0f);
+}
+
+vec3 toSrgb(vec3 linear)
+{
+	return mix(linear * 12.92f, 1.055f * pow(linear, vec3(1.0f / 2.4f)) - 0.055f, step(0.0031308f, linear));
+}
+
+vec3 toLinear(vec3 srgb)
+{
+	return mix(srgb / 12.92f, pow((srgb + 0.055f) / 1.055f, vec3(2.4f)), step(0.04045f, srgb));
+}
+
+// Interleaved gradient noise, shifted every frame so the pattern averages out
+float noise(vec2 position)
+{
+	position += float(PushConstants.frame % 64u) * 5.588238f;
+	return fract(52.9829189f * fract(dot(position, vec2(0.06711056f, 0.00583715f))));
+}
+
+void main() 
+{
+	vec2 uv = inUV * PushConstants.uvScale;
+
+	// Geometry covers the compute background wherever it was drawn
+	vec4 scene = texture(drawImage, uv);
+	vec3 background = texture(backgroundImage, uv).rgb;
+	vec3 color = mix(background, scene.rgb, scene.a) * PushConstants.exposure;
+
+	if (PushConstants.tonemapper == 1u)
+	{
+		color = reinhard(color);
+	}
+	else if (PushConstants.tonemapper == 2u)
+	{
+		color = aces(color);
+	}
+
+	// The swapchain is sRGB, dither in its encoded space so the noise matches the 8 bit steps
+	vec3 encoded = toSrgb(clamp(color, 0.0f, 1.0f));
+	encoded += (noise(gl_FragCoord.xy) - 0.5f) * PushConstants.ditherStrength / 255.0f;
+
+	outFragColor = vec4(toLinear(clamp(encoded, 0.0f, 1.0f)), 1.0f);
+}
@@ -1,10 +1,17 @@
 #version 450
 
 layout (location = 0) in vec4 inColor;
+#ifdef SHOW_UV
+layout (location = 1) in vec2 inUV;
+#endif
 
 layout (location = 0) out vec4 outFragColor;
 
 void main() 
 {
+#ifdef SHOW_UV
+	outFragColor = vec4(inUV, 0.0, 1.0);
+#else
 	outFragColor = inColor;
-}
\ No newline at end of file
+#endif
+}
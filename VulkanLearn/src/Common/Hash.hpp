@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace Common::Hash
+{
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	// 64 bit FNV-1a, pass the previous result as seed to hash several ranges as one
+	inline static uint64_t fnv1a(const void* data, size_t size, uint64_t seed = FNV_OFFSET)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+
+		return hash;
+	}
+
+	inline static uint64_t fnv1a(std::string_view text, uint64_t seed = FNV_OFFSET)
+	{
+		return fnv1a(text.data(), text.size(), seed);
+	}
+
+	template<typename T>
+	inline static uint64_t fnv1aValue(const T& value, uint64_t seed = FNV_OFFSET)
+	{
+		return fnv1a(&value, sizeof(T), seed);
+	}
+
+	inline static std::string toHex(uint64_t hash)
+	{
+		return fmt::format("{:016x}", hash);
+	}
+}
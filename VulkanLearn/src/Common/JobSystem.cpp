@@ -0,0 +1,455 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+static thread_local int32_t t_threadIndex = -1;
+
+namespace Common
+{
+	void JobSystem::Init(uint32_t workerCount)
+	{
+		if (workerCount == 0)
+		{
+			// One core is left for the main thread and one for the IO lane
+			workerCount = std::max(std::thread::hardware_concurrency(), 3u) - 2;
+		}
+
+		_stop = false;
+		_queues.clear();
+		for (uint32_t i = 0; i < workerCount + 1; i++)
+		{
+			_queues.push_back(std::make_unique<ThreadQueue>());
+		}
+
+		t_threadIndex = (int32_t)workerCount;
+
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			_workers.emplace_back(&JobSystem::WorkerLoop, this, (int32_t)i);
+		}
+		_ioThread = std::thread(&JobSystem::IOLoop, this);
+
+		_statsStart = std::chrono::steady_clock::now();
+
+		spdlog::info("Sistema de trabajos con {0} hilos", workerCount);
+	}
+
+	void JobSystem::Shutdown()
+	{
+		{
+			std::lock_guard lock(_sleepMutex);
+			_stop = true;
+		}
+		_condition.notify_all();
+
+		{
+			std::lock_guard lock(_ioMutex);
+		}
+		_ioCondition.notify_all();
+
+		for (auto& worker : _workers)
+		{
+			worker.join();
+		}
+
+		// The IO thread drains its queue first, it may still schedule work meanwhile
+		if (_ioThread.joinable())
+		{
+			_ioThread.join();
+		}
+
+		CompleteDroppedJobs();
+
+		_workers.clear();
+		_queues.clear();
+		t_threadIndex = -1;
+	}
+
+	JobCounterPtr JobSystem::CreateCounter() const
+	{
+		return std::make_shared<JobCounter>();
+	}
+
+	void JobSystem::Schedule(std::function<void()>&& function, JobLane lane, const JobCounterPtr& counter, const JobCounterPtr& dependency)
+	{
+		if (counter)
+		{
+			counter->_pending.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Job job{ std::move(function), counter };
+
+		if (dependency)
+		{
+			std::lock_guard lock(dependency->_mutex);
+			if (!dependency->IsDone())
+			{
+				dependency->_continuations.push_back([this, job = std::move(job), lane]() mutable
+					{
+						Enqueue(std::move(job), lane);
+					}
+				);
+				return;
+			}
+		}
+
+		Enqueue(std::move(job), lane);
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function)
+	{
+		batchSize = std::max(batchSize, 1u);
+
+		if (count <= batchSize || _workers.empty())
+		{
+			function(0, count);
+			return;
+		}
+
+		JobCounterPtr counter = CreateCounter();
+		for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+		{
+			uint32_t end = std::min(begin + batchSize, count);
+			Schedule([&function, begin, end]() { function(begin, end); }, JobLane::Worker, counter);
+		}
+
+		function(0, batchSize);
+
+		Wait(counter);
+	}
+
+	void JobSystem::Wait(const JobCounterPtr& counter)
+	{
+		int32_t threadIndex = t_threadIndex;
+
+		while (!counter->IsDone())
+		{
+			if (threadIndex >= 0)
+			{
+				Job job;
+				if (TryGetJob(threadIndex, job))
+				{
+					Execute(job, threadIndex);
+					continue;
+				}
+			}
+
+			std::unique_lock lock(_sleepMutex);
+			_condition.wait_for(lock, std::chrono::milliseconds(1), [&]()
+				{
+					bool isWorker = threadIndex >= 0 && threadIndex < (int32_t)_workers.size();
+					return counter->IsDone()
+						|| (threadIndex >= 0 && _queuedJobs.load() > 0)
+						|| (isWorker && _queuedBackgroundJobs.load() > 0);
+				}
+			);
+		}
+	}
+
+	void JobSystem::RunMainThreadJobs()
+	{
+		std::vector<Job> jobs;
+		{
+			std::lock_guard lock(_mainMutex);
+			jobs.swap(_mainJobs);
+		}
+
+		for (auto& job : jobs)
+		{
+			Execute(job, (int32_t)_workers.size());
+		}
+	}
+
+	int32_t JobSystem::GetThreadIndex() const
+	{
+		return t_threadIndex;
+	}
+
+	std::vector<JobThreadStats> JobSystem::CollectStats()
+	{
+		auto now = std::chrono::steady_clock::now();
+		double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now - _statsStart).count();
+		_statsStart = now;
+
+		std::vector<JobThreadStats> stats;
+		for (auto& queue : _queues)
+		{
+			uint64_t busy = queue->BusyNanoseconds.exchange(0);
+			stats.push_back(
+				{
+					.Utilization = elapsed > 0.0 ? (float)std::min(1.0, busy / elapsed) : 0.0f,
+					.Jobs = queue->ExecutedJobs.exchange(0),
+					.Steals = queue->Steals.exchange(0),
+				}
+			);
+		}
+
+		return stats;
+	}
+
+	void JobSystem::Enqueue(Job&& job, JobLane lane)
+	{
+		switch (lane)
+		{
+			case JobLane::Main:
+			{
+				std::lock_guard lock(_mainMutex);
+				_mainJobs.push_back(std::move(job));
+				return;
+			}
+
+			case JobLane::IO:
+			{
+				{
+					std::lock_guard lock(_ioMutex);
+					_ioJobs.push_back(std::move(job));
+				}
+				_ioCondition.notify_one();
+				return;
+			}
+
+			case JobLane::Background:
+			{
+				if (_workers.empty())
+				{
+					break;
+				}
+
+				{
+					std::lock_guard lock(_backgroundMutex);
+					_backgroundJobs.push_back(std::move(job));
+					_queuedBackgroundJobs.fetch_add(1);
+				}
+				NotifySleepers();
+				return;
+			}
+
+			case JobLane::Worker:
+				break;
+		}
+
+		if (_workers.empty())
+		{
+			// Without workers the job runs inline
+			Execute(job, t_threadIndex);
+			return;
+		}
+
+		// Workers push to their own deque, anyone else distributes round robin
+		int32_t threadIndex = t_threadIndex;
+		uint32_t queueIndex = (threadIndex >= 0 && threadIndex < (int32_t)_workers.size())
+			? (uint32_t)threadIndex
+			: _nextQueue.fetch_add(1) % (uint32_t)_workers.size();
+
+		// Counted under the queue mutex, a thief can never pop the job before it is counted
+		{
+			std::lock_guard lock(_queues[queueIndex]->Mutex);
+			_queues[queueIndex]->Jobs.push_back(std::move(job));
+			_queuedJobs.fetch_add(1);
+		}
+		NotifySleepers();
+	}
+
+	void JobSystem::NotifySleepers()
+	{
+		// Sleepers test the counts holding the mutex, taking it here means none is between its test and its wait
+		{
+			std::lock_guard lock(_sleepMutex);
+		}
+		_condition.notify_all();
+	}
+
+	bool JobSystem::TryGetJob(int32_t threadIndex, Job& job)
+	{
+		uint32_t workerCount = (uint32_t)_workers.size();
+
+		// Own work is taken LIFO for cache locality
+		if (threadIndex < (int32_t)workerCount)
+		{
+			ThreadQueue& own = *_queues[threadIndex];
+			std::lock_guard lock(own.Mutex);
+			if (!own.Jobs.empty())
+			{
+				job = std::move(own.Jobs.back());
+				own.Jobs.pop_back();
+				_queuedJobs.fetch_sub(1);
+				return true;
+			}
+		}
+
+		// Stolen work is taken FIFO from the other end
+		for (uint32_t i = 1; i <= workerCount; i++)
+		{
+			uint32_t victim = (threadIndex + i) % workerCount;
+			if ((int32_t)victim == threadIndex)
+			{
+				continue;
+			}
+
+			ThreadQueue& queue = *_queues[victim];
+			std::lock_guard lock(queue.Mutex);
+			if (!queue.Jobs.empty())
+			{
+				job = std::move(queue.Jobs.front());
+				queue.Jobs.pop_front();
+				_queuedJobs.fetch_sub(1);
+				_queues[threadIndex]->Steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		// Background work only once no worker job is left, and never on the main thread
+		if (threadIndex < (int32_t)workerCount)
+		{
+			std::lock_guard lock(_backgroundMutex);
+			if (!_backgroundJobs.empty())
+			{
+				job = std::move(_backgroundJobs.front());
+				_backgroundJobs.pop_front();
+				_queuedBackgroundJobs.fetch_sub(1);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Execute(Job& job, int32_t threadIndex)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		try
+		{
+			job.Function();
+		}
+		catch (const std::exception& e)
+		{
+			spdlog::error("Error en trabajo: {0}", e.what());
+		}
+
+		if (threadIndex >= 0 && threadIndex < (int32_t)_queues.size())
+		{
+			auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			_queues[threadIndex]->BusyNanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+			_queues[threadIndex]->ExecutedJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (job.Counter)
+		{
+			Complete(job.Counter);
+		}
+	}
+
+	void JobSystem::Complete(const JobCounterPtr& counter)
+	{
+		if (counter->_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+
+		std::vector<std::function<void()>> continuations;
+		{
+			std::lock_guard lock(counter->_mutex);
+			continuations.swap(counter->_continuations);
+		}
+
+		for (auto& continuation : continuations)
+		{
+			continuation();
+		}
+
+		NotifySleepers();
+	}
+
+	void JobSystem::WorkerLoop(int32_t threadIndex)
+	{
+		t_threadIndex = threadIndex;
+
+		while (!_stop)
+		{
+			Job job;
+			if (TryGetJob(threadIndex, job))
+			{
+				Execute(job, threadIndex);
+				continue;
+			}
+
+			std::unique_lock lock(_sleepMutex);
+			_condition.wait(lock, [this]() { return _stop || _queuedJobs.load() > 0 || _queuedBackgroundJobs.load() > 0; });
+		}
+	}
+
+	void JobSystem::IOLoop()
+	{
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock lock(_ioMutex);
+				_ioCondition.wait(lock, [this]() { return _stop || !_ioJobs.empty(); });
+
+				// Queued jobs still run after a stop, the pipeline cache save is one of them
+				if (_ioJobs.empty())
+				{
+					return;
+				}
+
+				job = std::move(_ioJobs.front());
+				_ioJobs.pop_front();
+			}
+
+			Execute(job, -1);
+		}
+	}
+
+	void JobSystem::CompleteDroppedJobs()
+	{
+		// Completing a counter can queue its continuations, repeat until nothing is left
+		while (true)
+		{
+			std::vector<Job> dropped;
+			for (auto& queue : _queues)
+			{
+				std::lock_guard lock(queue->Mutex);
+				dropped.insert(dropped.end(), std::make_move_iterator(queue->Jobs.begin()), std::make_move_iterator(queue->Jobs.end()));
+				queue->Jobs.clear();
+			}
+			{
+				std::lock_guard lock(_backgroundMutex);
+				dropped.insert(dropped.end(), std::make_move_iterator(_backgroundJobs.begin()), std::make_move_iterator(_backgroundJobs.end()));
+				_backgroundJobs.clear();
+			}
+			{
+				std::lock_guard lock(_mainMutex);
+				dropped.insert(dropped.end(), std::make_move_iterator(_mainJobs.begin()), std::make_move_iterator(_mainJobs.end()));
+				_mainJobs.clear();
+			}
+			{
+				std::lock_guard lock(_ioMutex);
+				dropped.insert(dropped.end(), std::make_move_iterator(_ioJobs.begin()), std::make_move_iterator(_ioJobs.end()));
+				_ioJobs.clear();
+			}
+
+			_queuedJobs = 0;
+			_queuedBackgroundJobs = 0;
+
+			if (dropped.empty())
+			{
+				return;
+			}
+
+			spdlog::warn("{0} trabajos descartados al cerrar", dropped.size());
+
+			for (auto& job : dropped)
+			{
+				if (job.Counter)
+				{
+					Complete(job.Counter);
+				}
+			}
+		}
+	}
+}
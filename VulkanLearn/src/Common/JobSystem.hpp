@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+
+namespace Common
+{
+	enum class JobLane : uint8_t
+	{
+		// Any worker, stolen between workers when idle
+		Worker = 0,
+		// Drained by the main thread through RunMainThreadJobs, once per frame
+		Main = 1,
+		// Dedicated thread for blocking file and network access
+		IO = 2,
+		// Long work like shader compiles and pipeline builds. Only workers run it, after their worker jobs,
+		// so the main thread never picks it up while it helps in Wait.
+		Background = 3
+	};
+
+	class JobCounter
+	{
+	public:
+		inline bool IsDone() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint32_t> _pending = 0;
+		std::mutex _mutex;
+		std::vector<std::function<void()>> _continuations;
+	};
+
+	using JobCounterPtr = std::shared_ptr<JobCounter>;
+
+	struct JobThreadStats
+	{
+		float Utilization;
+		uint32_t Jobs;
+		uint32_t Steals;
+	};
+
+	class JobSystem
+	{
+	public:
+		// The calling thread is registered as the main thread
+		void Init(uint32_t workerCount = 0);
+		void Shutdown();
+
+		JobCounterPtr CreateCounter() const;
+
+		// counter: incremented now and decremented when the job finishes
+		// dependency: the job is not queued until this counter reaches zero
+		void Schedule(
+			std::function<void()>&& job,
+			JobLane lane = JobLane::Worker,
+			const JobCounterPtr& counter = nullptr,
+			const JobCounterPtr& dependency = nullptr);
+
+		// Runs function over [0, count) in batches, the caller runs the first batch and helps until all are done
+		void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+
+		// Workers and the main thread execute worker jobs while waiting, workers also run background jobs,
+		// any other thread blocks. Main lane jobs only run from RunMainThreadJobs, never wait on them from the main thread.
+		void Wait(const JobCounterPtr& counter);
+
+		void RunMainThreadJobs();
+
+		// 0..WorkerCount-1 for workers, WorkerCount for the main thread, -1 for any other thread
+		int32_t GetThreadIndex() const;
+		inline uint32_t GetWorkerCount() const { return (uint32_t)_workers.size(); }
+
+		// Utilization of every worker and the main thread since the previous call
+		std::vector<JobThreadStats> CollectStats();
+
+	private:
+		struct Job
+		{
+			std::function<void()> Function;
+			JobCounterPtr Counter;
+		};
+
+		struct ThreadQueue
+		{
+			std::mutex Mutex;
+			std::deque<Job> Jobs;
+
+			std::atomic<uint64_t> BusyNanoseconds = 0;
+			std::atomic<uint32_t> ExecutedJobs = 0;
+			std::atomic<uint32_t> Steals = 0;
+		};
+
+		void Enqueue(Job&& job, JobLane lane);
+		bool TryGetJob(int32_t threadIndex, Job& job);
+		void Execute(Job& job, int32_t threadIndex);
+		void Complete(const JobCounterPtr& counter);
+		void NotifySleepers();
+
+		void WorkerLoop(int32_t threadIndex);
+		void IOLoop();
+		// After the threads are joined, so a late Wait on a job that never ran cannot hang
+		void CompleteDroppedJobs();
+
+	private:
+		std::vector<std::thread> _workers;
+		std::thread _ioThread;
+
+		// One queue per worker plus one for the main thread statistics
+		std::vector<std::unique_ptr<ThreadQueue>> _queues;
+		std::atomic<uint32_t> _nextQueue = 0;
+		std::atomic<uint32_t> _queuedJobs = 0;
+
+		std::mutex _backgroundMutex;
+		std::deque<Job> _backgroundJobs;
+		std::atomic<uint32_t> _queuedBackgroundJobs = 0;
+
+		std::mutex _mainMutex;
+		std::vector<Job> _mainJobs;
+
+		std::mutex _ioMutex;
+		std::condition_variable _ioCondition;
+		std::deque<Job> _ioJobs;
+
+		std::mutex _sleepMutex;
+		std::condition_variable _condition;
+		std::atomic<bool> _stop = false;
+
+		std::chrono::steady_clock::time_point _statsStart;
+	};
+}
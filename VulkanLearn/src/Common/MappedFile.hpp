@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Common
+{
+	// Read only view of a whole file, pages are loaded by the OS as they are touched
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// False when the file is missing or empty
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		inline bool IsOpen() const { return _data != nullptr; }
+		inline const uint8_t* GetData() const { return _data; }
+		inline size_t GetSize() const { return _size; }
+
+	private:
+		const uint8_t* _data = nullptr;
+		size_t _size = 0;
+
+#ifdef _WIN32
+		void* _file = nullptr;
+		void* _mapping = nullptr;
+#else
+		int _file = -1;
+#endif
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace Common
+{
+	// Lock-free ring buffer for exactly one producer thread and one consumer thread.
+	// Capacity must be a power of two, one slot is always left empty.
+	template<typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	public:
+		// Producer only, returns false when full
+		bool Push(const T& value)
+		{
+			size_t head = _head.load(std::memory_order_relaxed);
+			size_t next = (head + 1) & (Capacity - 1);
+
+			if (next == _tail.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			_items[head] = value;
+			_head.store(next, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only, returns false when empty
+		bool Pop(T& value)
+		{
+			size_t tail = _tail.load(std::memory_order_relaxed);
+
+			if (tail == _head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			value = _items[tail];
+			_tail.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// Head and tail on separate cache lines so producer and consumer do not false share
+		alignas(64) std::atomic<size_t> _head = 0;
+		alignas(64) std::atomic<size_t> _tail = 0;
+		std::array<T, Capacity> _items = {};
+	};
+}
@@ -1,6 +1,9 @@
 #pragma once
+#include <atomic>
+#include <thread>
 #include <vector>
 #include <fstream>
+#include <filesystem>
 #include <spdlog/spdlog.h>
 
 namespace Common::Utils
@@ -24,4 +27,42 @@ namespace Common::Utils
 
 		return buffer;
 	}
+
+	// Writes next to the target and renames over it, readers never see a partially written file
+	inline static bool writeFileAtomic(const std::filesystem::path& path, const void* data, size_t size)
+	{
+		std::error_code error;
+		if (path.has_parent_path())
+		{
+			std::filesystem::create_directories(path.parent_path(), error);
+		}
+
+		// Several threads can save the same file, each one writes its own temporary
+		static std::atomic<uint32_t> writeCount = 0;
+		std::filesystem::path temporary = path;
+		temporary += fmt::format(".{:x}.{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()), writeCount++);
+
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				spdlog::error("No se pudo escribir el archivo {0}", temporary.string());
+				return false;
+			}
+
+			file.write(reinterpret_cast<const char*>(data), size);
+			if (!file.good()) {
+				spdlog::error("No se pudo escribir el archivo {0}", temporary.string());
+				return false;
+			}
+		}
+
+		std::filesystem::rename(temporary, path, error);
+		if (error) {
+			spdlog::error("No se pudo reemplazar el archivo {0}: {1}", path.string(), error.message());
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+
+		return true;
+	}
 }
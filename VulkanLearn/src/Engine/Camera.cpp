@@ -10,23 +10,23 @@ namespace Engine
 		UpdateCameraVectors();
 	}
 
-	void Camera::OnUpdate(float dt)
+	void Camera::OnUpdate(float dt, const InputState& input)
 	{
 		float speed = _speed * dt;
 
-		if (Engine::InputState::Up)
+		if (input.Up)
 		{
 			_position += speed * _front;
 		}
-		if (Engine::InputState::Down)
+		if (input.Down)
 		{
 			_position -= speed * _front;
 		}
-		if (Engine::InputState::Left)
+		if (input.Left)
 		{
 			_position -= glm::normalize(glm::cross(_front, _up)) * speed;
 		}
-		if (Engine::InputState::Right)
+		if (input.Right)
 		{
 			_position += glm::normalize(glm::cross(_front, _up)) * speed;
 		}
@@ -4,6 +4,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "InputState.hpp"
+
 namespace Engine
 {
 	class Camera
@@ -12,7 +14,7 @@ namespace Engine
 		Camera(uint32_t width, uint32_t height);
 		virtual ~Camera() {}
 
-		void OnUpdate(float dt);
+		void OnUpdate(float dt, const InputState& input);
 
 		void OnScroll(float yOffset);
 		void OnMouseMove(float xOffset, float yOffset);
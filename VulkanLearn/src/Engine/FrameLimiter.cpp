@@ -0,0 +1,112 @@
+#include "FrameLimiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace Engine
+{
+	FrameLimiter::FrameLimiter()
+	{
+		_lastFrame = Clock::now();
+		_deadline = _lastFrame;
+	}
+
+	void FrameLimiter::SetTargetFps(float fps)
+	{
+		_targetFps = std::max(fps, 0.0f);
+		_period = _targetFps > 0.0f
+			? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _targetFps))
+			: Clock::duration{};
+		_deadline = Clock::now();
+	}
+
+	void FrameLimiter::Wait()
+	{
+		Clock::time_point start = Clock::now();
+
+		if (_targetFps > 0.0f)
+		{
+			_deadline += _period;
+
+			// After a long stall start over instead of rushing frames to catch up
+			if (_deadline < start)
+			{
+				_deadline = start;
+			}
+
+			PreciseSleep(_deadline);
+		}
+
+		Clock::time_point now = Clock::now();
+		_lastSleepMs = std::chrono::duration<float, std::milli>(now - start).count();
+
+		_history[_historyIndex] = std::chrono::duration<float, std::milli>(now - _lastFrame).count();
+		_historyIndex = (_historyIndex + 1) % HISTORY_SIZE;
+		_historyCount = std::min(_historyCount + 1, HISTORY_SIZE);
+		_lastFrame = now;
+	}
+
+	FramePacingStats FrameLimiter::GetStats() const
+	{
+		FramePacingStats stats = {};
+		if (_historyCount == 0)
+		{
+			return stats;
+		}
+
+		std::array<float, HISTORY_SIZE> sorted;
+		float sum = 0.0f;
+		for (size_t i = 0; i < _historyCount; i++)
+		{
+			sorted[i] = _history[i];
+			sum += _history[i];
+		}
+		std::sort(sorted.begin(), sorted.begin() + _historyCount);
+
+		stats.AverageMs = sum / _historyCount;
+		stats.MinMs = sorted[0];
+		stats.MaxMs = sorted[_historyCount - 1];
+		stats.Percentile99Ms = sorted[std::min(_historyCount - 1, (size_t)(_historyCount * 0.99f))];
+
+		float variance = 0.0f;
+		for (size_t i = 0; i < _historyCount; i++)
+		{
+			float difference = sorted[i] - stats.AverageMs;
+			variance += difference * difference;
+		}
+		stats.StdDevMs = std::sqrt(variance / _historyCount);
+		stats.SleepMs = _lastSleepMs;
+
+		return stats;
+	}
+
+	void FrameLimiter::PreciseSleep(Clock::time_point deadline)
+	{
+		// Sleep in 1ms steps while the remaining time covers the worst expected oversleep
+		while (true)
+		{
+			double remaining = std::chrono::duration<double>(deadline - Clock::now()).count();
+			if (remaining <= _sleepEstimate)
+			{
+				break;
+			}
+
+			Clock::time_point start = Clock::now();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			double observed = std::chrono::duration<double>(Clock::now() - start).count();
+
+			_sleepCount++;
+			double delta = observed - _sleepMean;
+			_sleepMean += delta / _sleepCount;
+			_sleepM2 += delta * (observed - _sleepMean);
+			_sleepEstimate = _sleepMean + std::sqrt(_sleepM2 / (_sleepCount - 1));
+		}
+
+		// Spin the rest, sleeping again could overshoot by a whole timer tick
+		while (Clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
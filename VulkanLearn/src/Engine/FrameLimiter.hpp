@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Engine
+{
+	struct FramePacingStats
+	{
+		float AverageMs;
+		float MinMs;
+		float MaxMs;
+		float StdDevMs;
+		float Percentile99Ms;
+		float SleepMs;
+	};
+
+	// Waits for the next frame deadline. Call it before polling input so the sampled input is as fresh as possible
+	// when the frame is recorded, instead of sleeping after present and rendering with stale input.
+	class FrameLimiter
+	{
+	public:
+		static const size_t HISTORY_SIZE = 240;
+
+	public:
+		FrameLimiter();
+
+		// 0 disables the limit
+		void SetTargetFps(float fps);
+		inline float GetTargetFps() const { return _targetFps; }
+
+		void Wait();
+
+		FramePacingStats GetStats() const;
+
+		// Frame times in milliseconds, oldest first starting at GetHistoryOffset
+		inline const std::array<float, HISTORY_SIZE>& GetHistory() const { return _history; }
+		inline size_t GetHistoryOffset() const { return _historyIndex; }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void PreciseSleep(Clock::time_point deadline);
+
+	private:
+		float _targetFps = 0.0f;
+		Clock::duration _period = {};
+		Clock::time_point _deadline;
+		Clock::time_point _lastFrame;
+
+		// Running estimate of how long a 1ms sleep really takes, OS timers are coarse
+		double _sleepEstimate = 0.005;
+		double _sleepMean = 0.005;
+		double _sleepM2 = 0.0;
+		uint64_t _sleepCount = 1;
+
+		std::array<float, HISTORY_SIZE> _history = {};
+		size_t _historyIndex = 0;
+		size_t _historyCount = 0;
+		float _lastSleepMs = 0.0f;
+	};
+}
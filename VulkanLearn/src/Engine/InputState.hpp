@@ -1,13 +1,67 @@
 #pragma once
+#include <cstdint>
 
 namespace Engine
 {
+	enum class InputKey : uint8_t
+	{
+		Up,
+		Down,
+		Left,
+		Right
+	};
+
+	enum class InputEventType : uint8_t
+	{
+		Key,
+		Scroll
+	};
+
+	struct InputEvent
+	{
+		InputEventType Type;
+		InputKey Key;
+		bool Pressed;
+		float Scroll;
+	};
+
+	// Owned by the simulation thread, rebuilt from the events the window thread queues
 	class InputState
 	{
 	public:
-		inline static bool Up;
-		inline static bool Down;
-		inline static bool Left;
-		inline static bool Right;
+		inline void Apply(const InputEvent& event)
+		{
+			switch (event.Type)
+			{
+				case InputEventType::Key:
+					switch (event.Key)
+					{
+						case InputKey::Up: Up = event.Pressed; break;
+						case InputKey::Down: Down = event.Pressed; break;
+						case InputKey::Left: Left = event.Pressed; break;
+						case InputKey::Right: Right = event.Pressed; break;
+					}
+					break;
+
+				case InputEventType::Scroll:
+					Scroll += event.Scroll;
+					break;
+			}
+		}
+
+		// Scroll accumulates between simulation steps
+		inline float ConsumeScroll()
+		{
+			float scroll = Scroll;
+			Scroll = 0.0f;
+			return scroll;
+		}
+
+	public:
+		bool Up = false;
+		bool Down = false;
+		bool Left = false;
+		bool Right = false;
+		float Scroll = 0.0f;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,104 @@
+#include "Simulation.hpp"
+
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+namespace Engine
+{
+	void Simulation::Start()
+	{
+		_stop = false;
+		_thread = std::thread(&Simulation::Loop, this);
+
+		spdlog::info("Hilo de simulacion iniciado");
+	}
+
+	void Simulation::Stop()
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_stop = true;
+		}
+		_condition.notify_all();
+
+		if (_thread.joinable())
+		{
+			_thread.join();
+		}
+	}
+
+	void Simulation::PushInput(const InputEvent& event)
+	{
+		if (!_inputQueue.Push(event))
+		{
+			spdlog::warn("Cola de entrada llena, evento descartado");
+		}
+	}
+
+	SceneSnapshotPtr Simulation::AcquireSnapshot()
+	{
+		SceneSnapshotPtr snapshot;
+		{
+			std::unique_lock lock(_mutex);
+			_condition.wait(lock, [this]() { return _published != nullptr || _stop; });
+			snapshot = std::move(_published);
+			_published = nullptr;
+		}
+		_condition.notify_all();
+
+		return snapshot;
+	}
+
+	void Simulation::Loop()
+	{
+		auto last = std::chrono::steady_clock::now();
+
+		while (!_stop)
+		{
+			auto now = std::chrono::steady_clock::now();
+			float dt = std::chrono::duration<float>(now - last).count();
+			last = now;
+
+			SceneSnapshotPtr snapshot = Step(dt);
+
+			std::unique_lock lock(_mutex);
+			_condition.wait(lock, [this]() { return _published == nullptr || _stop; });
+			_published = std::move(snapshot);
+			lock.unlock();
+			_condition.notify_all();
+		}
+	}
+
+	SceneSnapshotPtr Simulation::Step(float dt)
+	{
+		InputEvent event;
+		while (_inputQueue.Pop(event))
+		{
+			_input.Apply(event);
+		}
+
+		_time += dt;
+		_rotation += ROTATION_SPEED * dt;
+
+		glm::vec3 direction = { 0.0f, 0.0f, 0.0f };
+		if (_input.Up) direction.y += 1.0f;
+		if (_input.Down) direction.y -= 1.0f;
+		if (_input.Left) direction.x += 1.0f;
+		if (_input.Right) direction.x -= 1.0f;
+
+		_cameraOffset += direction * CAMERA_SPEED * dt;
+		_cameraOffset.z += _input.ConsumeScroll() * ZOOM_SPEED;
+
+		return std::make_shared<const SceneSnapshot>(
+			SceneSnapshot
+			{
+				.Frame = _frame++,
+				.Time = _time,
+				.DeltaTime = dt,
+				.Rotation = _rotation,
+				.CameraOffset = _cameraOffset,
+			}
+		);
+	}
+}
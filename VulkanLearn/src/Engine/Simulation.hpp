@@ -0,0 +1,71 @@
+#pragma once
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "InputState.hpp"
+#include "../Common/SpscQueue.hpp"
+
+namespace Engine
+{
+	// Everything the renderer needs from one simulation step, never modified after it is published
+	struct SceneSnapshot
+	{
+		uint64_t Frame;
+		float Time;
+		float DeltaTime;
+
+		float Rotation;
+		glm::vec3 CameraOffset;
+	};
+
+	using SceneSnapshotPtr = std::shared_ptr<const SceneSnapshot>;
+
+	// Steps the scene on its own thread one frame ahead of the renderer.
+	// While the renderer records snapshot N the next step already runs, and waits there until N+1 is taken.
+	class Simulation
+	{
+	public:
+		static const size_t INPUT_QUEUE_SIZE = 256;
+
+		inline static const float ROTATION_SPEED = 30.0f;
+		inline static const float CAMERA_SPEED = 10.0f;
+		inline static const float ZOOM_SPEED = 2.0f;
+
+	public:
+		void Start();
+		void Stop();
+
+		// Window thread only
+		void PushInput(const InputEvent& event);
+
+		// Render thread only, blocks until the next step is published
+		SceneSnapshotPtr AcquireSnapshot();
+
+	private:
+		void Loop();
+		SceneSnapshotPtr Step(float dt);
+
+	private:
+		std::thread _thread;
+		std::atomic<bool> _stop = false;
+
+		Common::SpscQueue<InputEvent, INPUT_QUEUE_SIZE> _inputQueue;
+		InputState _input;
+
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		SceneSnapshotPtr _published;
+
+		// Only touched by the simulation thread
+		uint64_t _frame = 0;
+		float _time = 0.0f;
+		float _rotation = 0.0f;
+		glm::vec3 _cameraOffset = { 0.0f, 0.0f, 0.0f };
+	};
+}
@@ -3,6 +3,7 @@
 #include <set>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -20,13 +21,13 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/vulkan/imgui_impl_vulkan.h>
 
-#include "../Engine/InputState.hpp"
 #include "../Vulkan/Utils.hpp"
 #include "../Vulkan/Init.hpp"
 #include "../Vulkan/Image.hpp"
 #include "../Common/Utils.hpp"
 #include "../Engine/Model.hpp"
 #include "../Vulkan/Common/GraphicsPipelineBuilder.hpp"
+#include "../Vulkan/Common/BarrierBuilder.hpp"
 
 #define VMA_IMPLEMENTATION
 #include <vma/vk_mem_alloc.h>
@@ -73,6 +74,19 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL messageCallback(
 	return VK_FALSE;
 }
 
+// Shared by the pipeline builder and the shader object state, both backends draw the mesh the same way
+template<typename State>
+static void configureMeshState(State& state)
+{
+	state
+		.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+		.SetPolygonMode(VK_POLYGON_MODE_FILL)
+		.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
+		.SetMultisamplingNone()
+		.EnableBlendingAlphablend()
+		.EnableDepthtest(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+}
+
 namespace HelloVulkan
 {
 	App::App()
@@ -81,9 +95,12 @@ namespace HelloVulkan
 
 	void App::Run()
 	{
+		_jobSystem.Init();
 		InitWindow();
 		InitVulkan();
+		_simulation.Start();
 		Loop();
+		_simulation.Stop();
 		Clean();
 	}
 
@@ -99,6 +116,50 @@ namespace HelloVulkan
 
 	void App::OnScroll(double yoffset)
 	{
+		if (ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureMouse)
+		{
+			return;
+		}
+
+		_simulation.PushInput(
+			{
+				.Type = Engine::InputEventType::Scroll,
+				.Scroll = (float)yoffset,
+			}
+		);
+	}
+
+	void App::OnKey(int key, int action)
+	{
+		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		{
+			glfwSetWindowShouldClose(_window, GLFW_TRUE);
+			return;
+		}
+
+		Engine::InputKey inputKey;
+		switch (key)
+		{
+			case GLFW_KEY_W: case GLFW_KEY_UP: inputKey = Engine::InputKey::Up; break;
+			case GLFW_KEY_S: case GLFW_KEY_DOWN: inputKey = Engine::InputKey::Down; break;
+			case GLFW_KEY_A: case GLFW_KEY_LEFT: inputKey = Engine::InputKey::Left; break;
+			case GLFW_KEY_D: case GLFW_KEY_RIGHT: inputKey = Engine::InputKey::Right; break;
+			default: return;
+		}
+
+		// Releases always go through so no key is left pressed when ImGui takes the focus
+		if (action == GLFW_REPEAT || (action == GLFW_PRESS && ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureKeyboard))
+		{
+			return;
+		}
+
+		_simulation.PushInput(
+			{
+				.Type = Engine::InputEventType::Key,
+				.Key = inputKey,
+				.Pressed = action == GLFW_PRESS,
+			}
+		);
 	}
 
 	void App::InitWindow()
@@ -131,6 +192,13 @@ namespace HelloVulkan
 			}
 		);
 
+		glfwSetKeyCallback(_window, [](GLFWwindow* window, int key, int scancode, int action, int mods)
+			{
+				auto app = reinterpret_cast<App*>(glfwGetWindowUserPointer(window));
+				app->OnKey(key, action);
+			}
+		);
+
 		if (!_window) {
 			throw std::exception("Error al crear la ventana");
 		}
@@ -144,15 +212,33 @@ namespace HelloVulkan
         int frameCount = 0;
 
         while (!glfwWindowShouldClose(_window)) {
+			// Waiting before polling keeps the input sampled as close as possible to the frame that uses it
+			_frameLimiter.Wait();
+
             float currentFrame = static_cast<float>(glfwGetTime());
             _deltaTime = currentFrame - _lastFrame;
             _lastFrame = currentFrame;
 
             glfwPollEvents();
+			_jobSystem.RunMainThreadJobs();
 
-			OnUpdate(_deltaTime);
+			if (_pipelineCache.ConsumeSaveDue())
+			{
+				_jobSystem.Schedule([this]() { _pipelineCache.Save(); }, Common::JobLane::IO);
+			}
 
+#ifndef VL_USE_SHADER_BUNDLE
+			if ((!_shaderReload || _shaderReload->IsDone()) && _shaderWatcher.ConsumeScanDue())
+			{
+				ScheduleShaderReload();
+			}
+#endif
+
+			OnUpdate(_deltaTime);
 
+			// Only the simulation has its own thread. Recording and submission stay here with events, ImGui and
+			// main lane jobs, GLFW swapchain resizes and the UI changes to render state are main thread only.
+			// Main lane jobs are kept to handle swaps so they do not delay the frame.
 			if (_doRender)
 			{
 				OnImGuiRender();
@@ -168,6 +254,7 @@ namespace HelloVulkan
             frameCount++;
             if (currentTime - lastTime >= 0.5) {
 				_fps = frameCount / (currentTime - lastTime);;
+				_jobStats = _jobSystem.CollectStats();
                 frameCount = 0;
                 lastTime = currentTime;
             }
@@ -180,25 +267,58 @@ namespace HelloVulkan
 	{
 		spdlog::info("Limpiando");
 
-		vkDestroyImageView(_logicalDevice, _depthImage.ImageView, nullptr);
-		vmaDestroyImage(_allocator, _depthImage.Image, _depthImage.Allocation);
+		// A reload still in flight would leave its pipelines behind
+		if (_shaderReload)
+		{
+			_jobSystem.Wait(_shaderReload);
+		}
+		if (_meshVariantSwitch)
+		{
+			_jobSystem.Wait(_meshVariantSwitch);
+		}
+		_jobSystem.RunMainThreadJobs();
+		_asyncPipelines.Wait();
+		_graphicsPipelines.Wait();
+
+		_jobSystem.Shutdown();
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			_frames[i].DeletionQueue.Flush();
+		}
+
+		_renderGraph.Destroy();
+		_recorder.Destroy();
+		_workgroupTuner.Destroy();
+		_pipelineCache.Destroy();
 
-		vkDestroyImageView(_logicalDevice, _drawImage.ImageView, nullptr);
-		vmaDestroyImage(_allocator, _drawImage.Image, _drawImage.Allocation);
+		DestroyImage(_drawImage);
+		for (auto& frame : _frames) {
+			DestroyImage(frame.Background);
+		}
 
 		DeletionQueue.Flush();
 
-		vkDestroyDescriptorSetLayout(_logicalDevice, _descriptorSetLayout, nullptr);
-		_descriptorAllocator.DestroyPool(_logicalDevice);
+		if (_shaderObjects.IsAvailable())
+		{
+			_shaderObjects.Destroy(_meshShaderObject);
+		}
+		_graphicsPipelines.Destroy();
+		_layoutCache.Destroy();
+		vkDestroySampler(_logicalDevice, _drawImageSampler, nullptr);
+		_backgroundDescriptorTemplate.Destroy(_logicalDevice);
+		_presentDescriptorTemplate.Destroy(_logicalDevice);
+		for (auto& frame : _frames) {
+			frame.Descriptors.DestroyPools(_logicalDevice);
+		}
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(_logicalDevice, _frames[i].ImageAvailableSemaphore, nullptr);
 			vkDestroySemaphore(_logicalDevice, _frames[i].RenderFinishedSemaphore, nullptr);
 			vkDestroyFence(_logicalDevice, _frames[i].Fence, nullptr);
 			vkDestroyCommandPool(_logicalDevice, _frames[i].CommandPool, nullptr);
-
-			_frames[i].DeletionQueue.Flush();
+			vkDestroyCommandPool(_logicalDevice, _frames[i].ComputeCommandPool, nullptr);
 		}
+		vkDestroySemaphore(_logicalDevice, _computeTimeline, nullptr);
 
 		CleanUpSwapChain();
 
@@ -222,10 +342,8 @@ namespace HelloVulkan
 
 	void App::OnUpdate(float dt)
 	{
-		if (glfwGetKey(_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-		{
-			glfwSetWindowShouldClose(_window, GLFW_TRUE);
-		}
+		// The next step starts simulating as soon as this one is taken
+		_snapshot = _simulation.AcquireSnapshot();
 	}
 
 	void App::OnImGuiRender()
@@ -270,9 +388,107 @@ namespace HelloVulkan
 		if (ImGui::Begin("Utils"))
 		{
 			ImGui::Text("FPS: %.1f", _fps);
+			ImGui::Text("Simulation frame: %llu (%.2f ms)", _snapshot->Frame, _snapshot->DeltaTime * 1000.0f);
+
+			ImGui::Text("Async compute: %s", _computeQueueFamilyIndex != _graphicsQueueFamilyIndex ? "yes" : "no (graphics queue)");
 
 			ImGui::Text("Width: %d", _width);
 			ImGui::Text("Height: %d", _height);
+
+			const auto& graphStats = _renderGraph.GetStats();
+			ImGui::Text("Passes: %u (%u culled)", graphStats.Passes, graphStats.CulledPasses);
+			ImGui::Text("Barriers: %u in %u batches", graphStats.Barriers, graphStats.BarrierBatches);
+			ImGui::Text("Transient memory: %llu KB (%llu KB unaliased)",
+				graphStats.TransientMemory / 1024,
+				graphStats.TransientMemoryUnaliased / 1024);
+
+			auto pipelineStats = _graphicsPipelines.GetStats();
+			ImGui::Text("Graphics pipelines: %u (%u reused)", pipelineStats.Pipelines, pipelineStats.Hits);
+			ImGui::Text("Pipeline creation: %.2f ms total, %.2f ms max", pipelineStats.TotalMilliseconds, pipelineStats.MaxMilliseconds);
+			if (_graphicsPipelines.UsesLibraries())
+			{
+				ImGui::Text("Pipeline libraries: %u, %u/%u optimized", pipelineStats.Libraries, pipelineStats.Optimized, pipelineStats.Pipelines);
+			}
+			ImGui::Text("Pipelines compiling: %u", _asyncPipelines.GetPendingCount());
+		}
+		ImGui::End();
+
+		if (ImGui::Begin("Presentation"))
+		{
+			static const std::pair<VkPresentModeKHR, const char*> presentModes[] =
+			{
+				{ VK_PRESENT_MODE_FIFO_KHR, "FIFO" },
+				{ VK_PRESENT_MODE_FIFO_RELAXED_KHR, "FIFO Relaxed" },
+				{ VK_PRESENT_MODE_MAILBOX_KHR, "Mailbox" },
+				{ VK_PRESENT_MODE_IMMEDIATE_KHR, "Immediate" },
+			};
+
+			auto presentModeName = [&](VkPresentModeKHR mode)
+				{
+					for (const auto& [value, name] : presentModes)
+					{
+						if (value == mode) return name;
+					}
+					return "Unknown";
+				};
+
+			if (ImGui::BeginCombo("Present mode", presentModeName(_presentMode)))
+			{
+				for (const auto& [value, name] : presentModes)
+				{
+					if (ImGui::Selectable(name, value == _presentMode) && value != _presentMode)
+					{
+						_presentMode = value;
+						_resized = true;
+					}
+				}
+				ImGui::EndCombo();
+			}
+			ImGui::Text("Active: %s", presentModeName(_activePresentMode));
+
+			if (ImGui::SliderInt("FPS limit", &_fpsLimit, 0, 360, _fpsLimit == 0 ? "Off" : "%d"))
+			{
+				_frameLimiter.SetTargetFps((float)_fpsLimit);
+			}
+
+			Engine::FramePacingStats pacing = _frameLimiter.GetStats();
+			ImGui::Text("Frame: %.2f ms avg, %.2f min, %.2f max", pacing.AverageMs, pacing.MinMs, pacing.MaxMs);
+			ImGui::Text("Jitter: %.2f ms, 99th: %.2f ms", pacing.StdDevMs, pacing.Percentile99Ms);
+			ImGui::Text("Limiter sleep: %.2f ms", pacing.SleepMs);
+
+			const auto& history = _frameLimiter.GetHistory();
+			ImGui::PlotLines("##FrameTimes", history.data(), (int)history.size(), (int)_frameLimiter.GetHistoryOffset(),
+				nullptr, 0.0f, pacing.MaxMs * 1.2f, ImVec2(0.0f, 60.0f));
+		}
+		ImGui::End();
+
+		if (ImGui::Begin("Post"))
+		{
+			static const char* tonemappers[] = { "None", "Reinhard", "ACES" };
+
+			ImGui::SliderFloat("Render scale", &_renderScale, 0.25f, 1.0f);
+			ImGui::SliderFloat("Exposure", &_exposure, 0.0f, 8.0f);
+			ImGui::Combo("Tonemapper", &_tonemapper, tonemappers, IM_ARRAYSIZE(tonemappers));
+			ImGui::SliderFloat("Dither", &_ditherStrength, 0.0f, 2.0f);
+		}
+		ImGui::End();
+
+		if (ImGui::Begin("Jobs"))
+		{
+			for (size_t i = 0; i < _jobStats.size(); i++)
+			{
+				const auto& stats = _jobStats[i];
+				bool isMain = i == _jobStats.size() - 1;
+
+				char label[64];
+				snprintf(label, sizeof(label), "%.0f%%", stats.Utilization * 100.0f);
+
+				ImGui::Text(isMain ? "Main     " : "Worker %2zu", i);
+				ImGui::SameLine();
+				ImGui::ProgressBar(stats.Utilization, ImVec2(120.0f, 0.0f), label);
+				ImGui::SameLine();
+				ImGui::Text("%u jobs, %u steals", stats.Jobs, stats.Steals);
+			}
 		}
 		ImGui::End();
 
@@ -283,6 +499,7 @@ namespace HelloVulkan
 			ImGui::Text("Selected effect: ", selected.Name);
 
 			ImGui::SliderInt("Effect Index", &_currentBackgroundEffect, 0, uint32_t(_backgroundEffects.size() - 1));
+			ImGui::Text("Workgroup: %ux%ux%u", selected.WorkgroupSize[0], selected.WorkgroupSize[1], selected.WorkgroupSize[2]);
 
 			ImGui::ColorEdit4("Data1", (float*)&selected.Data.Data1);
 			ImGui::ColorEdit4("Data2", (float*)&selected.Data.Data2);
@@ -295,6 +512,22 @@ namespace HelloVulkan
 			ImGui::Text("Selected mesh: ", _testMeshes[_currentMesh]->Name);
 
 			ImGui::SliderInt("Index", &_currentMesh, 0, uint32_t(_testMeshes.size() - 1));
+			ImGui::SliderInt("Copies", &_meshCopies, 1, 10000);
+			ImGui::Text("Draws: %zu (%s)", _drawList.size(), _drawList.size() >= PARALLEL_RECORD_THRESHOLD ? "parallel" : "inline");
+			ImGui::Text("Culled: %u", _culledDraws);
+			ImGui::Text("Pipeline: %s", _meshPipeline->IsReady() ? "ready" : _meshPipeline->HasFailed() ? "failed" : "compiling");
+			if (_shaderObjects.IsAvailable())
+			{
+				ImGui::Checkbox("Shader objects", &_useShaderObjects);
+			}
+
+			Renderer::ShaderKeywordMask showUV = _meshVariants.GetKeywordMask(MESH_KEYWORD_SHOW_UV);
+			bool showUVEnabled = (_meshKeywords & showUV) != 0;
+			if (ImGui::Checkbox("Show UVs", &showUVEnabled))
+			{
+				SetMeshKeywords(showUVEnabled ? _meshKeywords | showUV : _meshKeywords & ~showUV);
+			}
+			ImGui::Text("Shader variants: %zu", _meshVariants.GetVariantCount());
 		}
 		ImGui::End();
 
@@ -312,6 +545,26 @@ namespace HelloVulkan
 
 	void App::InitVulkan()
 	{
+		// Every stage compiles on the workers while the device is created, each pipeline waits only for its own
+#ifdef VL_USE_SHADER_BUNDLE
+		// Cooked ahead of time, every stage is a copy out of the mapped bundle
+		if (!_shaderBundle.Open(SHADER_BUNDLE_PATH))
+		{
+			throw std::exception("No se pudo abrir el paquete de shaders, genera uno con --cook");
+		}
+		_shaderCompiler.Init(_jobSystem, &_shaderBundle);
+#else
+		_shaderCompiler.Init(_jobSystem);
+#endif
+		auto computeShader = _shaderCompiler.Compile(COMPUTE_SHADER_PATH, Renderer::ShaderType::Compute);
+
+		// The UV view is a debug toggle, compiled ahead of time so switching only waits for the pipeline
+		_meshVariants.Init(_shaderCompiler, "Mesh Shader", MESH_VERTEX_SHADER_PATH, MESH_FRAGMENT_SHADER_PATH, MESH_KEYWORDS);
+		_meshVariants.Prewarm(_meshKeywords);
+		_meshVariants.Prewarm(_meshVariants.GetKeywordMask(MESH_KEYWORD_SHOW_UV));
+		auto presentVertexShader = _shaderCompiler.Compile(PRESENT_VERTEX_SHADER_PATH, Renderer::ShaderType::Vertex);
+		auto presentFragmentShader = _shaderCompiler.Compile(PRESENT_FRAGMENT_SHADER_PATH, Renderer::ShaderType::Fragment);
+
 		auto data = Vulkan::boostrapVulkan(_window, messageCallback, true);
 		_instance = data.instance;
 		_messenger = data.debugMessenger;
@@ -322,6 +575,13 @@ namespace HelloVulkan
 		_graphicsQueueFamilyIndex = data.graphicsQueueFamilyIndex;
 		_presentQueue = data.presentQueue;
 		_presentQueueFamilyIndex = data.presentQueueFamilyIndex;
+		_computeQueue = data.computeQueue;
+		_computeQueueFamilyIndex = data.computeQueueFamilyIndex;
+
+		if (_computeQueueFamilyIndex != _graphicsQueueFamilyIndex)
+		{
+			spdlog::info("Cola de computo asincrona en la familia {0}", _computeQueueFamilyIndex);
+		}
 
 		VmaAllocatorCreateInfo allocatorInfo
 		{
@@ -332,6 +592,20 @@ namespace HelloVulkan
 		};
 		vmaCreateAllocator(&allocatorInfo, &_allocator);
 
+		_renderGraph.Init(_logicalDevice, _allocator);
+		_pipelineCache.Init(_logicalDevice, _physicalDevice, CACHE_DIRECTORY);
+		_layoutCache.Init(_logicalDevice);
+		// Timed on the queue of ImmediateSubmit
+		_workgroupTuner.Init(_logicalDevice, _physicalDevice, _graphicsQueueFamilyIndex, CACHE_DIRECTORY);
+		_graphicsPipelines.Init(_logicalDevice, _pipelineCache.Get(), _jobSystem, data.graphicsPipelineLibrary);
+		spdlog::info("Pipelines graficos {0}", data.graphicsPipelineLibrary ? "enlazados desde librerias" : "monoliticos");
+		_asyncPipelines.Init(_jobSystem, _graphicsPipelines);
+		if (_shaderObjects.Init(_logicalDevice, data.shaderObject))
+		{
+			_useShaderObjects = std::getenv("VL_SHADER_OBJECTS") != nullptr;
+			spdlog::info("Shader objects disponibles, {0}", _useShaderObjects ? "activados" : "desactivados");
+		}
+
 		DeletionQueue.Push([&]() 
 			{
 				vmaDestroyAllocator(_allocator);
@@ -341,87 +615,151 @@ namespace HelloVulkan
 		CreateSyncObjects();
 		CreateSwapChain();
 		CreateCommands();
-		CreateDescriptors();
-		CreatePipeline();
+		_recorder.Init(_logicalDevice, _graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, _jobSystem);
+		CreatePipeline(computeShader);
 		InitializeImgui();
 		CreateMeshPipeline();
+		CreatePresentPipeline(presentVertexShader, presentFragmentShader);
+		CreateDescriptors();
+		TuneBackgroundEffects();
+#ifndef VL_USE_SHADER_BUNDLE
+		_shaderWatcher.Init(SHADER_DIRECTORY);
+#endif
 		UploadDefaultMeshData();
 	}
 
+	bool App::CookShaders(const std::filesystem::path& output)
+	{
+		Renderer::ShaderBundleWriter bundle;
+
+		auto add = [&](const char* path, Renderer::ShaderType type, const std::vector<std::string>& defines = {})
+		{
+			bundle.Add(path, type, defines, Renderer::ShaderCompiler::CompileNow(path, type, defines));
+		};
+
+		add(COMPUTE_SHADER_PATH, Renderer::ShaderType::Compute);
+		add(PRESENT_VERTEX_SHADER_PATH, Renderer::ShaderType::Vertex);
+		add(PRESENT_FRAGMENT_SHADER_PATH, Renderer::ShaderType::Fragment);
+
+		// Every keyword combination, the runtime can not compile a missing one
+		for (Renderer::ShaderKeywordMask mask = 0; mask < (Renderer::ShaderKeywordMask(1) << MESH_KEYWORDS.size()); mask++)
+		{
+			auto defines = Renderer::ShaderVariantCache::GetDefines(MESH_KEYWORDS, mask);
+			add(MESH_VERTEX_SHADER_PATH, Renderer::ShaderType::Vertex, defines);
+			add(MESH_FRAGMENT_SHADER_PATH, Renderer::ShaderType::Fragment, defines);
+		}
+
+		if (!bundle.Write(output))
+		{
+			return false;
+		}
+
+		spdlog::info("Paquete de shaders escrito en '{0}'", output.string());
+
+		return true;
+	}
+
 	void App::CreateSwapChain()
 	{
-		auto data = Vulkan::boostrapSwapchain(_width, _height, _physicalDevice, _logicalDevice, _surface);
+		auto data = Vulkan::boostrapSwapchain(_width, _height, _physicalDevice, _logicalDevice, _surface, _presentMode, _swapChain);
 		_swapChain = data.swapchain;
 		_swapChainImageFormat = data.imageFormat;
 		_swapChainExtent = data.extent;
+		_activePresentMode = data.presentMode;
 		_swapChainImages = data.images;
 		_swapChainImageViews = data.imageViews;
 
-		//Draw Image
+		// The draw image only grows, smaller windows render into a sub-rectangle of it
+		if (_drawImage.Image == VK_NULL_HANDLE
+			|| _swapChainExtent.width > _drawImage.ImageExtent.width
+			|| _swapChainExtent.height > _drawImage.ImageExtent.height)
+		{
+			CreateDrawImage(
+				std::max(_swapChainExtent.width, _drawImage.ImageExtent.width),
+				std::max(_swapChainExtent.height, _drawImage.ImageExtent.height));
+		}
+	}
+
+	void App::CreateDrawImage(uint32_t width, uint32_t height)
+	{
 		if (_drawImage.Image != VK_NULL_HANDLE)
 		{
-			vkDestroyImageView(_logicalDevice, _drawImage.ImageView, nullptr);
-			vmaDestroyImage(_allocator, _drawImage.Image, _drawImage.Allocation);
+			RetireResource([this, image = _drawImage]() { DestroyImage(image); });
+			_renderGraph.ForgetImage(_drawImage.Image);
 			_drawImage.Image = VK_NULL_HANDLE;
 		}
 
 		VkExtent3D drawImageExtent
 		{
-			.width = _width,
-			.height = _height,
+			.width = width,
+			.height = height,
 			.depth = 1,
 		};
 
-		_drawImage.ImageFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
-		_drawImage.ImageExtent = drawImageExtent;
-
-		VkImageUsageFlags drawImageUsages = VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+		VkImageUsageFlags drawImageUsages = VK_IMAGE_USAGE_SAMPLED_BIT
 			| VK_IMAGE_USAGE_TRANSFER_DST_BIT
 			| VK_IMAGE_USAGE_STORAGE_BIT
 			| VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-		VkImageCreateInfo drawImageInfo = Vulkan::Init::imageCreateInfo(
-			_drawImage.ImageFormat,
-			drawImageUsages,
-			_drawImage.ImageExtent);
+		_drawImage = AllocateImage(VK_FORMAT_R16G16B16A16_SFLOAT, drawImageUsages, drawImageExtent);
 
-		VmaAllocationCreateInfo imageAllocInfo
+		// Every frame has its own background so the compute queue never writes one still being sampled
+		for (auto& frame : _frames)
 		{
-			.usage = VMA_MEMORY_USAGE_GPU_ONLY,
-			.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		};
+			if (frame.Background.Image != VK_NULL_HANDLE)
+			{
+				RetireResource([this, image = frame.Background]() { DestroyImage(image); });
+			}
 
-		VK_CHECK(vmaCreateImage(_allocator, &drawImageInfo, &imageAllocInfo, &_drawImage.Image, &_drawImage.Allocation, nullptr));
+			frame.Background = AllocateImage(
+				VK_FORMAT_R16G16B16A16_SFLOAT,
+				VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+				drawImageExtent,
+				true);
+		}
+	}
 
-		VkImageViewCreateInfo drawImageViewInfo = Vulkan::Init::imageViewCreateInfo(
-			_drawImage.ImageFormat,
-			_drawImage.Image,
-			VK_IMAGE_ASPECT_COLOR_BIT);
+	Image App::AllocateImage(VkFormat format, VkImageUsageFlags usage, VkExtent3D extent, bool sharedWithCompute)
+	{
+		Image image
+		{
+			.ImageExtent = extent,
+			.ImageFormat = format,
+		};
 
-		VK_CHECK(vkCreateImageView(_logicalDevice, &drawImageViewInfo, nullptr, &_drawImage.ImageView));
+		VkImageCreateInfo imageInfo = Vulkan::Init::imageCreateInfo(format, usage, extent);
 
-		//Depth Image
-		if (_depthImage.Image != VK_NULL_HANDLE)
+		// Concurrent sharing avoids queue family ownership transfers between compute and graphics
+		uint32_t queueFamilies[] = { _graphicsQueueFamilyIndex, _computeQueueFamilyIndex };
+		if (sharedWithCompute && _computeQueueFamilyIndex != _graphicsQueueFamilyIndex)
 		{
-			vkDestroyImageView(_logicalDevice, _depthImage.ImageView, nullptr);
-			vmaDestroyImage(_allocator, _depthImage.Image, _depthImage.Allocation);
-			_depthImage.Image = VK_NULL_HANDLE;
+			imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+			imageInfo.queueFamilyIndexCount = 2;
+			imageInfo.pQueueFamilyIndices = queueFamilies;
 		}
 
-		_depthImage.ImageFormat = VK_FORMAT_D32_SFLOAT;
-		_depthImage.ImageExtent = drawImageExtent;
-		VkImageUsageFlags depthImageUsages = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		VmaAllocationCreateInfo imageAllocInfo
+		{
+			.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+			.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		};
+
+		VK_CHECK(vmaCreateImage(_allocator, &imageInfo, &imageAllocInfo, &image.Image, &image.Allocation, nullptr));
 
-		VkImageCreateInfo depthImageInfo = Vulkan::Init::imageCreateInfo(_depthImage.ImageFormat, depthImageUsages, drawImageExtent);
+		VkImageViewCreateInfo imageViewInfo = Vulkan::Init::imageViewCreateInfo(
+			format,
+			image.Image,
+			VK_IMAGE_ASPECT_COLOR_BIT);
 
-		vmaCreateImage(_allocator, &depthImageInfo, &imageAllocInfo, &_depthImage.Image, &_depthImage.Allocation, nullptr);
+		VK_CHECK(vkCreateImageView(_logicalDevice, &imageViewInfo, nullptr, &image.ImageView));
 
-		VkImageViewCreateInfo depthImageViewInfo = Vulkan::Init::imageViewCreateInfo(
-			_depthImage.ImageFormat, 
-			_depthImage.Image, 
-			VK_IMAGE_ASPECT_DEPTH_BIT);
+		return image;
+	}
 
-		VK_CHECK(vkCreateImageView(_logicalDevice, &depthImageViewInfo, nullptr, &_depthImage.ImageView));
+	void App::DestroyImage(const Image& image)
+	{
+		vkDestroyImageView(_logicalDevice, image.ImageView, nullptr);
+		vmaDestroyImage(_allocator, image.Image, image.Allocation);
 	}
 
 	void App::CreateCommands()
@@ -437,6 +775,18 @@ namespace HelloVulkan
 			VkCommandBufferAllocateInfo allocInfo = Vulkan::Init::commandBufferAllocateInfo(_frames[i].CommandPool, 1);
 			VK_CHECK(vkAllocateCommandBuffers(_logicalDevice, &allocInfo, &_frames[i].CommandBuffer));
 		}
+
+		VkCommandPoolCreateInfo computePoolInfo = Vulkan::Init::commandPoolCreateInfo(
+			_computeQueueFamilyIndex,
+			VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		{
+			VK_CHECK(vkCreateCommandPool(_logicalDevice, &computePoolInfo, nullptr, &_frames[i].ComputeCommandPool));
+
+			VkCommandBufferAllocateInfo allocInfo = Vulkan::Init::commandBufferAllocateInfo(_frames[i].ComputeCommandPool, 1);
+			VK_CHECK(vkAllocateCommandBuffers(_logicalDevice, &allocInfo, &_frames[i].ComputeCommandBuffer));
+		}
 		
 		// Immediate ImGui Command Pool
 		VK_CHECK(vkCreateCommandPool(_logicalDevice, &poolInfo, nullptr, &_immCommandPool));
@@ -466,6 +816,18 @@ namespace HelloVulkan
 			VK_CHECK(vkCreateFence(_logicalDevice, &fenceInfo, nullptr, &_frames[i].Fence));
 		}
 
+		VkSemaphoreTypeCreateInfo timelineInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+			.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+			.initialValue = 0,
+		};
+
+		VkSemaphoreCreateInfo timelineSemaphoreInfo = Vulkan::Init::semaphoreCreateInfo();
+		timelineSemaphoreInfo.pNext = &timelineInfo;
+
+		VK_CHECK(vkCreateSemaphore(_logicalDevice, &timelineSemaphoreInfo, nullptr, &_computeTimeline));
+
 		// Immediate ImGui Sync Objects
 		VK_CHECK(vkCreateFence(_logicalDevice, &fenceInfo, nullptr, &_immFence));
 
@@ -478,15 +840,25 @@ namespace HelloVulkan
 
 	void App::RecreateSwapChain()
 	{
-		VK_CHECK(vkDeviceWaitIdle(_logicalDevice));
+		// Frames in flight may still reference the old swapchain, it is handed to the new one and destroyed once they retire
+		VkSwapchainKHR oldSwapchain = _swapChain;
+		std::vector<VkImageView> oldImageViews = _swapChainImageViews;
 
-		CleanUpSwapChain();
+		for (VkImage image : _swapChainImages)
+		{
+			_renderGraph.ForgetImage(image);
+		}
 
 		CreateSwapChain();
 
-		vkDestroyDescriptorSetLayout(_logicalDevice, _descriptorSetLayout, nullptr);
-		_descriptorAllocator.DestroyPool(_logicalDevice);
-		CreateDescriptors();
+		RetireResource([=, device = _logicalDevice]()
+			{
+				for (auto imageView : oldImageViews) {
+					vkDestroyImageView(device, imageView, nullptr);
+				}
+				vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+			}
+		);
 
 		_resized = false;
 	}
@@ -500,106 +872,234 @@ namespace HelloVulkan
 		}
 	}
 
-	void App::CreateDescriptors()
+	void App::RetireResource(std::function<void()>&& destroy)
 	{
-		Vulkan::Common::DescriptorLayoutBuilder builder;
-		builder.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
-		_descriptorSetLayout = builder.Build(_logicalDevice, VK_SHADER_STAGE_COMPUTE_BIT);
+		// Every frame flushes its queue after waiting its fence, so the last flush means no submission can use the resource
+		auto pending = std::make_shared<size_t>(MAX_FRAMES_IN_FLIGHT);
+		auto function = std::make_shared<std::function<void()>>(std::move(destroy));
 
-		std::vector<Vulkan::Common::DescriptorAllocator::PoolSizeRatio> sizes =
+		for (auto& frame : _frames)
 		{
-			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
-		};
-
-		_descriptorAllocator.InitPool(_logicalDevice, 10, sizes);
-
-		_descriptorSet = _descriptorAllocator.Allocate(_logicalDevice, _descriptorSetLayout);
+			frame.DeletionQueue.Push([pending, function]()
+				{
+					if (--*pending == 0)
+					{
+						(*function)();
+					}
+				}
+			);
+		}
+	}
 
-		VkDescriptorImageInfo imageInfo
+	void App::CreateDescriptors()
+	{
+		// Set layouts come from shader reflection, so this runs after the pipelines
+		std::vector<Vulkan::Common::DescriptorAllocator::PoolSizeRatio> sizes =
 		{
-			.imageView = _drawImage.ImageView,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
 		};
 
-		VkWriteDescriptorSet writeDescriptorSet
+		// Linear so the present pass can upscale a reduced render resolution
+		VkSamplerCreateInfo samplerInfo
 		{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.pNext = nullptr,
-			.dstSet = _descriptorSet,
-			.dstBinding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-			.pImageInfo = &imageInfo,
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_LINEAR,
+			.minFilter = VK_FILTER_LINEAR,
+			.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
 		};
 
-		vkUpdateDescriptorSets(_logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+		VK_CHECK(vkCreateSampler(_logicalDevice, &samplerInfo, nullptr, &_drawImageSampler));
+
+		// Both sets are written every frame, the templates skip building the writes each time
+		_backgroundDescriptorTemplate
+			.AddEntry(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, offsetof(BackgroundDescriptors, Image))
+			.Build(_logicalDevice, _descriptorSetLayout);
+		_presentDescriptorTemplate
+			.AddEntry(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(PresentDescriptors, DrawImage))
+			.AddEntry(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, offsetof(PresentDescriptors, Background))
+			.Build(_logicalDevice, _presentDescriptorSetLayout);
+
+		// Sized for the frame sets, anything else allocated per frame grows the pools once and reuses them after
+		for (auto& frame : _frames)
+		{
+			frame.Descriptors.Init(_logicalDevice, 2, sizes);
+			AllocateFrameDescriptors(frame);
+		}
 	}
 
-	void App::CreatePipeline()
+	void App::AllocateFrameDescriptors(HelloVulkan::Frame& frame)
 	{
+		frame.DescriptorSet = frame.Descriptors.Allocate(_logicalDevice, _descriptorSetLayout);
+		frame.PresentDescriptorSet = frame.Descriptors.Allocate(_logicalDevice, _presentDescriptorSetLayout);
 
-		VkPushConstantRange pushConstant
+		BackgroundDescriptors background
 		{
-			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-			.offset = 0,
-			.size = sizeof(ComputePushConstants),
+			.Image
+			{
+				.imageView = frame.Background.ImageView,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			},
 		};
 
-		VkPipelineLayoutCreateInfo computeLayout
+		// The background stays in GENERAL, it is written and sampled on different queues without transitions
+		PresentDescriptors present
 		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-			.pNext = nullptr,
-			.setLayoutCount = 1,
-			.pSetLayouts = &_descriptorSetLayout,
-			.pushConstantRangeCount = 1,
-			.pPushConstantRanges = &pushConstant,
+			.DrawImage
+			{
+				.sampler = _drawImageSampler,
+				.imageView = _drawImage.ImageView,
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			},
+			.Background
+			{
+				.sampler = _drawImageSampler,
+				.imageView = frame.Background.ImageView,
+				.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+			},
 		};
 
-		VK_CHECK(vkCreatePipelineLayout(_logicalDevice, &computeLayout, nullptr, &_pipelineLayout));
-
-		_computeShader = Renderer::ComputeShader::Create("Compute Shader", "assets/shaders/shader.comp");
-		VkShaderModule computeShaderModule = _computeShader->BuildModule(_logicalDevice);
+		_backgroundDescriptorTemplate.Update(_logicalDevice, frame.DescriptorSet, background);
+		_presentDescriptorTemplate.Update(_logicalDevice, frame.PresentDescriptorSet, present);
+	}
 
-		VkPipelineShaderStageCreateInfo shaderStageInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
-			.module = computeShaderModule,
-			.pName = "main",
-		};
+	void App::CreatePipeline(const Renderer::ShaderFuture& computeShader)
+	{
+		_computeShader = Renderer::ComputeShader::Create("Compute Shader", computeShader);
+		_descriptorSetLayout = _layoutCache.GetSetLayout(_computeShader->GetReflection(), 0);
+		_pipelineLayout = _layoutCache.GetPipelineLayout(_computeShader->GetReflection());
 
-		VkComputePipelineCreateInfo pipelineInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-			.stage = shaderStageInfo,
-			.layout = _pipelineLayout,
-		};
+		const auto& workgroupSize = _computeShader->GetReflection().WorkgroupSize;
 
 		ComputeEffect gradient
 		{
 			.Name = "gradient",
+			.Pipeline = BuildComputePipeline(*_computeShader, workgroupSize),
 			.Layout = _pipelineLayout,
 			.Data
 			{
 				.Data1 = glm::vec4(0.007f, 0.007f, 0.007f, 1),
 				.Data2 = glm::vec4(0.005f, 0.007f, 0.007f, 1),
-			}
+			},
+			.WorkgroupSize = workgroupSize,
 		};
 
-		VK_CHECK(vkCreateComputePipelines(_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &gradient.Pipeline));
-
-		vkDestroyShaderModule(_logicalDevice, computeShaderModule, nullptr);
-
 		_backgroundEffects.push_back(gradient);
 
+		// Hot reload swaps the pipelines, destroy whatever is current at exit
 		DeletionQueue.Push([=]()
 			{
-				vkDestroyPipeline(_logicalDevice, gradient.Pipeline, nullptr);
-				vkDestroyPipelineLayout(_logicalDevice, _pipelineLayout, nullptr);
+				for (const auto& effect : _backgroundEffects)
+				{
+					vkDestroyPipeline(_logicalDevice, effect.Pipeline, nullptr);
+				}
 			}
 		);
 	}
 
+	void App::TuneBackgroundEffects()
+	{
+		const auto& reflection = _computeShader->GetReflection();
+		uint64_t shaderHash = _computeShader->GetHash();
+
+		for (auto& effect : _backgroundEffects)
+		{
+			std::optional<Renderer::WorkgroupSize> tuned = _workgroupTuner.Find(effect.Name, shaderHash);
+			if (tuned)
+			{
+				if (*tuned != effect.WorkgroupSize)
+				{
+					vkDestroyPipeline(_logicalDevice, effect.Pipeline, nullptr);
+					effect.Pipeline = BuildComputePipeline(*_computeShader, *tuned);
+					effect.WorkgroupSize = *tuned;
+				}
+				continue;
+			}
+
+			if (!_workgroupTuner.CanTime())
+			{
+				continue;
+			}
+
+			auto candidates = _workgroupTuner.GetCandidates(reflection);
+			std::vector<VkPipeline> pipelines;
+			for (const auto& size : candidates)
+			{
+				pipelines.push_back(BuildComputePipeline(*_computeShader, size));
+			}
+
+			// Nothing is in flight yet, the background of the first frame is the target.
+			// No frame has set the draw extent, the whole image is measured.
+			VkExtent2D extent = { Frame().Background.ImageExtent.width, Frame().Background.ImageExtent.height };
+			ImmediateSubmit([&](VkCommandBuffer cmd)
+				{
+					Vulkan::Common::BarrierBuilder barriers;
+					barriers
+						.Image(Frame().Background.Image, Vulkan::Common::ResourceStates::Undefined, Vulkan::Common::ResourceStates::ComputeWrite, true)
+						.Flush(cmd);
+
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &Frame().DescriptorSet, 0, nullptr);
+					vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &effect.Data);
+
+					_workgroupTuner.Record(cmd, pipelines, candidates,
+						[this, extent](VkCommandBuffer cmd, VkPipeline pipeline, const Renderer::WorkgroupSize& size)
+						{
+							vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+							DispatchBackground(cmd, size, extent);
+						}
+					);
+				}
+			);
+
+			size_t fastest = _workgroupTuner.Resolve(effect.Name, shaderHash, candidates);
+
+			for (size_t i = 0; i < pipelines.size(); i++)
+			{
+				if (i != fastest)
+				{
+					vkDestroyPipeline(_logicalDevice, pipelines[i], nullptr);
+				}
+			}
+
+			vkDestroyPipeline(_logicalDevice, effect.Pipeline, nullptr);
+			effect.Pipeline = pipelines[fastest];
+			effect.WorkgroupSize = candidates[fastest];
+		}
+	}
+
+	VkPipeline App::BuildComputePipeline(const Renderer::ComputeShader& shader, const std::array<uint32_t, 3>& workgroupSize) const
+	{
+		const auto& reflection = shader.GetReflection();
+
+		// Dimensions declared with local_size_*_id are specialized, fixed ones must match what was asked
+		Vulkan::Common::SpecializationConstants specialization;
+		for (size_t i = 0; i < workgroupSize.size(); i++)
+		{
+			if (reflection.WorkgroupSizeSpecIds[i] != UINT32_MAX)
+			{
+				specialization.Set(reflection.WorkgroupSizeSpecIds[i], workgroupSize[i]);
+			}
+			else if (reflection.WorkgroupSize[i] != workgroupSize[i])
+			{
+				throw std::exception("El tamano del workgroup no es especializable en este shader");
+			}
+		}
+
+		VkShaderModule computeShaderModule = shader.BuildModule(_logicalDevice);
+
+		VkPipeline pipeline = Vulkan::Common::ComputePipelineBuilder(_pipelineLayout)
+			.SetShader(computeShaderModule)
+			.SetSpecialization(specialization)
+			.Build(_logicalDevice, _pipelineCache.Get());
+
+		vkDestroyShaderModule(_logicalDevice, computeShaderModule, nullptr);
+
+		return pipeline;
+	}
+
 	void App::InitializeImgui()
 	{
 		VkDescriptorPoolSize poolSizes[] = 
@@ -654,6 +1154,7 @@ namespace HelloVulkan
 			.MinImageCount = 3,
 			.ImageCount = 3,
 			.MSAASamples = VK_SAMPLE_COUNT_1_BIT,
+			.PipelineCache = _pipelineCache.Get(),
 			.UseDynamicRendering = true,
 			.PipelineRenderingCreateInfo = pipelineRenderingCreateInfo,
 		};
@@ -681,54 +1182,309 @@ namespace HelloVulkan
 
 	void App::CreateMeshPipeline()
 	{
-		_vertexShader = Renderer::Shader::Create("Vertex Shader", "assets/shaders/triangle.vert", "assets/shaders/triangle.frag");
-		VkShaderModule vertexShaderModule = _vertexShader->BuildModule(_logicalDevice, Renderer::ShaderType::Vertex);
-		VkShaderModule fragmentShaderModule = _vertexShader->BuildModule(_logicalDevice, Renderer::ShaderType::Fragment);
+		_vertexShader = _meshVariants.Get(_meshKeywords);
+		_meshPipelineLayout = _layoutCache.GetPipelineLayout(_vertexShader->GetReflection());
+		_meshPushConstantStages = _vertexShader->GetReflection().PushConstantStages;
+		_meshVariantSwitch = _jobSystem.CreateCounter();
 
-		auto size = sizeof(Vulkan::GPUDrawPushConstants);
-		VkPushConstantRange bufferRange
-		{
-			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-			.offset = 0,
-			.size = sizeof(Vulkan::GPUDrawPushConstants),
-		};
+		// Geometry is skipped for the first frames instead of waiting for the driver
+		_meshPipeline = RequestMeshPipeline(_vertexShader, _drawImage.ImageFormat, VK_NULL_HANDLE);
 
-		VkPipelineLayoutCreateInfo layoutInfo = Vulkan::Init::pipelineLayoutCreateInfo();
-		layoutInfo.pPushConstantRanges = &bufferRange;
-		layoutInfo.pushConstantRangeCount = 1;
+		// Nothing to compile per state, shader objects draw from the first frame
+		configureMeshState(_meshState);
+		_meshShaderObject = CreateMeshShaderObject(*_vertexShader);
+	}
+
+	void App::SetMeshKeywords(Renderer::ShaderKeywordMask keywords)
+	{
+		_meshKeywords = keywords;
 
-		VK_CHECK(vkCreatePipelineLayout(_logicalDevice, &layoutInfo, nullptr, &_meshPipelineLayout));
+		VkFormat drawFormat = _drawImage.ImageFormat;
 
+		// The current variant keeps drawing until the new one is compiled and its pipeline is ready
+		_jobSystem.Schedule([this, keywords, drawFormat]()
+			{
+				std::shared_ptr<Renderer::Shader> shader;
+				Renderer::ShaderObject shaderObject;
+				try
+				{
+					shader = _meshVariants.Get(keywords);
+					CheckReloadedLayout(shader->GetReflection(), _meshPipelineLayout);
+					shaderObject = CreateMeshShaderObject(*shader);
+				}
+				catch (const std::exception& e)
+				{
+					spdlog::error("No se pudo compilar la variante {0:#x} del shader de mallas: {1}", keywords, e.what());
+					return;
+				}
+
+				_jobSystem.Schedule([this, keywords, shader, shaderObject, drawFormat]()
+					{
+						// Superseded by a later toggle
+						if (keywords != _meshKeywords)
+						{
+							if (_shaderObjects.IsAvailable())
+							{
+								_shaderObjects.Destroy(shaderObject);
+							}
+							return;
+						}
+
+						_meshPipeline = RequestMeshPipeline(shader, drawFormat, _meshPipeline->Get());
+						_vertexShader = shader;
+						SwapMeshShaderObject(shaderObject);
+					},
+					Common::JobLane::Main
+				);
+			},
+			Common::JobLane::Background,
+			_meshVariantSwitch
+		);
+	}
+
+	Renderer::AsyncPipelinePtr App::RequestMeshPipeline(const std::shared_ptr<Renderer::Shader>& shader, VkFormat colorFormat, VkPipeline fallback)
+	{
 		Vulkan::Common::GraphicsPipelineBuilder pipelineBuilder(_meshPipelineLayout);
 
-		_meshPipeline = pipelineBuilder
-			.SetShaders(vertexShaderModule, fragmentShaderModule)
+		configureMeshState(pipelineBuilder);
+		pipelineBuilder
+			.SetColorAttachmentFormat(colorFormat)
+			.SetDepthFormat(DEPTH_FORMAT);
+
+		return _asyncPipelines.Request(pipelineBuilder, shader, fallback);
+	}
+
+	Renderer::ShaderObject App::CreateMeshShaderObject(const Renderer::Shader& shader)
+	{
+		if (!_shaderObjects.IsAvailable())
+		{
+			return {};
+		}
+
+		return _shaderObjects.Create(shader, _layoutCache);
+	}
+
+	void App::SwapMeshShaderObject(const Renderer::ShaderObject& shaderObject)
+	{
+		if (!_shaderObjects.IsAvailable())
+		{
+			return;
+		}
+
+		Renderer::ShaderObject old = _meshShaderObject;
+		_meshShaderObject = shaderObject;
+		RetireResource([this, old]() { _shaderObjects.Destroy(old); });
+	}
+
+	void App::CreatePresentPipeline(const Renderer::ShaderFuture& vertexShader, const Renderer::ShaderFuture& fragmentShader)
+	{
+		_presentShader = Renderer::Shader::Create("Present Shader", vertexShader, fragmentShader);
+		_presentDescriptorSetLayout = _layoutCache.GetSetLayout(_presentShader->GetReflection(), 0);
+		_presentPipelineLayout = _layoutCache.GetPipelineLayout(_presentShader->GetReflection());
+		_presentPushConstantStages = _presentShader->GetReflection().PushConstantStages;
+
+		_presentPipeline = BuildPresentPipeline(*_presentShader, _swapChainImageFormat);
+	}
+
+	VkPipeline App::BuildPresentPipeline(const Renderer::Shader& shader, VkFormat colorFormat)
+	{
+		Vulkan::Common::GraphicsPipelineBuilder pipelineBuilder(_presentPipelineLayout);
+
+		pipelineBuilder
 			.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
 			.SetPolygonMode(VK_POLYGON_MODE_FILL)
 			.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE)
 			.SetMultisamplingNone()
-			.EnableBlendingAlphablend()
-			.EnableDepthtest(true, VK_COMPARE_OP_LESS_OR_EQUAL)
-			.SetColorAttachmentFormat(_drawImage.ImageFormat)
-			.SetDepthFormat(_depthImage.ImageFormat)
-			.Build(_logicalDevice);
+			.DisableBlending()
+			.DisableDepthTesting()
+			.SetColorAttachmentFormat(colorFormat);
 
-		vkDestroyShaderModule(_logicalDevice, vertexShaderModule, nullptr);
-		vkDestroyShaderModule(_logicalDevice, fragmentShaderModule, nullptr);
+		return _graphicsPipelines.GetOrCreate(pipelineBuilder, shader);
+	}
 
-		DeletionQueue.Push([=]()
+	void App::ScheduleShaderReload()
+	{
+		_shaderReload = _jobSystem.CreateCounter();
+
+		// Formats are read here, the worker must not touch swapchain state
+		VkFormat drawFormat = _drawImage.ImageFormat;
+		VkFormat swapChainFormat = _swapChainImageFormat;
+
+		Renderer::ShaderKeywordMask meshKeywords = _meshKeywords;
+
+		_jobSystem.Schedule([this, counter = _shaderReload, drawFormat, swapChainFormat, meshKeywords]()
+			{
+				auto changed = _shaderWatcher.Scan();
+				if (changed.empty())
+				{
+					return;
+				}
+
+				_jobSystem.Schedule([this, changed, drawFormat, swapChainFormat, meshKeywords]()
+					{
+						ReloadShaders(changed, drawFormat, swapChainFormat, meshKeywords);
+					},
+					// Compiles and builds pipelines, the render thread must never pick it up
+					Common::JobLane::Background,
+					counter
+				);
+			},
+			Common::JobLane::IO,
+			_shaderReload
+		);
+	}
+
+	void App::ReloadShaders(
+		const std::vector<std::filesystem::path>& changed,
+		VkFormat drawFormat,
+		VkFormat swapChainFormat,
+		Renderer::ShaderKeywordMask meshKeywords)
+	{
+		auto touches = [&](std::initializer_list<const char*> paths)
+		{
+			for (const auto& file : changed)
 			{
-				vkDestroyPipeline(_logicalDevice, _meshPipeline, nullptr);
-				vkDestroyPipelineLayout(_logicalDevice, _meshPipelineLayout, nullptr);
+				// Anything that is not a stage may be an include of any of them
+				auto extension = file.extension();
+				if (extension != ".vert" && extension != ".frag" && extension != ".comp")
+				{
+					return true;
+				}
+
+				for (const char* path : paths)
+				{
+					if (file.filename() == std::filesystem::path(path).filename())
+					{
+						return true;
+					}
+				}
 			}
+
+			return false;
+		};
+
+		// A broken shader keeps the current pipeline, the next save tries again
+		auto rebuild = [](const char* name, const std::function<void()>& build)
+		{
+			try
+			{
+				build();
+			}
+			catch (const std::exception& e)
+			{
+				spdlog::error("No se pudo recargar '{0}', se mantiene el anterior: {1}", name, e.what());
+			}
+		};
+
+		std::shared_ptr<Renderer::ComputeShader> computeShader;
+		VkPipeline computePipeline = VK_NULL_HANDLE;
+		std::array<uint32_t, 3> computeWorkgroupSize = {};
+		if (touches({ COMPUTE_SHADER_PATH }))
+		{
+			rebuild("Compute Shader", [&]()
+				{
+					computeShader = Renderer::ComputeShader::Create("Compute Shader", COMPUTE_SHADER_PATH);
+					CheckReloadedLayout(computeShader->GetReflection(), _pipelineLayout);
+					// Code that was tuned before keeps its size, new code runs at the shader defaults until the next start tunes it
+					computeWorkgroupSize = _workgroupTuner.Find(_backgroundEffects[0].Name, computeShader->GetHash())
+						.value_or(computeShader->GetReflection().WorkgroupSize);
+					computePipeline = BuildComputePipeline(*computeShader, computeWorkgroupSize);
+				}
+			);
+		}
+
+		// Requested from the main thread with the live pipeline as fallback, it compiles while the old one keeps drawing
+		std::shared_ptr<Renderer::Shader> meshShader;
+		Renderer::ShaderObject meshShaderObject;
+		if (touches({ MESH_VERTEX_SHADER_PATH, MESH_FRAGMENT_SHADER_PATH }))
+		{
+			rebuild("Mesh Shader", [&]()
+				{
+					// Other variants are dropped and compile again when they are next used
+					auto shader = _meshVariants.Reload(meshKeywords);
+					CheckReloadedLayout(shader->GetReflection(), _meshPipelineLayout);
+					meshShaderObject = CreateMeshShaderObject(*shader);
+					meshShader = shader;
+				}
+			);
+		}
+
+		std::shared_ptr<Renderer::Shader> presentShader;
+		VkPipeline presentPipeline = VK_NULL_HANDLE;
+		if (touches({ PRESENT_VERTEX_SHADER_PATH, PRESENT_FRAGMENT_SHADER_PATH }))
+		{
+			rebuild("Present Shader", [&]()
+				{
+					presentShader = Renderer::Shader::Create("Present Shader", PRESENT_VERTEX_SHADER_PATH, PRESENT_FRAGMENT_SHADER_PATH);
+					CheckReloadedLayout(presentShader->GetReflection(), _presentPipelineLayout);
+					presentPipeline = BuildPresentPipeline(*presentShader, swapChainFormat);
+				}
+			);
+		}
+
+		if (computePipeline == VK_NULL_HANDLE && meshShader == nullptr && presentPipeline == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		// Swapped between frames, in-flight frames keep the old compute pipeline until their fences signal.
+		// Graphics pipelines stay in their cache, reverting an edit finds them again.
+		_jobSystem.Schedule([=, this]()
+			{
+				VkDevice device = _logicalDevice;
+
+				if (computePipeline != VK_NULL_HANDLE)
+				{
+					// The gradient is the only effect built from the compute shader
+					VkPipeline old = _backgroundEffects[0].Pipeline;
+					_backgroundEffects[0].Pipeline = computePipeline;
+					_backgroundEffects[0].WorkgroupSize = computeWorkgroupSize;
+					_computeShader = computeShader;
+					RetireResource([device, old]() { vkDestroyPipeline(device, old, nullptr); });
+				}
+
+				if (meshShader != nullptr && meshKeywords == _meshKeywords)
+				{
+					_meshPipeline = RequestMeshPipeline(meshShader, drawFormat, _meshPipeline->Get());
+					_vertexShader = meshShader;
+					SwapMeshShaderObject(meshShaderObject);
+				}
+				else if (meshShader != nullptr && _shaderObjects.IsAvailable())
+				{
+					_shaderObjects.Destroy(meshShaderObject);
+				}
+
+				if (presentPipeline != VK_NULL_HANDLE)
+				{
+					_presentPipeline = presentPipeline;
+					_presentShader = presentShader;
+				}
+
+				spdlog::info("Shaders recargados");
+			},
+			Common::JobLane::Main
 		);
 	}
 
+	void App::CheckReloadedLayout(const Renderer::ShaderReflection& reflection, VkPipelineLayout current)
+	{
+		// Descriptor sets and push constants are written for the current layout, a new interface needs a restart
+		if (_layoutCache.GetPipelineLayout(reflection) != current)
+		{
+			throw std::exception("La interfaz del shader cambio, reinicia la aplicacion para aplicarla");
+		}
+	}
+
 	void App::DrawFrame()
 	{
 		VK_CHECK(vkWaitForFences(_logicalDevice, 1, &Frame().Fence, VK_TRUE, UINT64_MAX));
 
 		Frame().DeletionQueue.Flush();
+		_recorder.BeginFrame((uint32_t)_currentFrame);
+
+		// Nothing submitted by this frame is pending anymore, its sets are dropped without freeing them one by one
+		Frame().Descriptors.ClearPools(_logicalDevice);
+		AllocateFrameDescriptors(Frame());
 
 		uint32_t imageIndex;
 		VkResult result = vkAcquireNextImageKHR(_logicalDevice, _swapChain, UINT64_MAX, Frame().ImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
@@ -742,8 +1498,11 @@ namespace HelloVulkan
 
 		VK_CHECK(vkResetFences(_logicalDevice, 1, &Frame().Fence));
 
-		_drawImageExtent.width = std::min(_swapChainExtent.width, _drawImage.ImageExtent.width);
-		_drawImageExtent.height = std::min(_swapChainExtent.height, _drawImage.ImageExtent.height);
+		_drawImageExtent.width = std::max(1u, (uint32_t)(std::min(_swapChainExtent.width, _drawImage.ImageExtent.width) * _renderScale));
+		_drawImageExtent.height = std::max(1u, (uint32_t)(std::min(_swapChainExtent.height, _drawImage.ImageExtent.height) * _renderScale));
+
+		// The background is generated on the compute queue while the graphics queue rasterizes geometry
+		uint64_t backgroundValue = SubmitBackground();
 
 		VkCommandBuffer currentCommandBuffer = Frame().CommandBuffer;
 
@@ -753,15 +1512,23 @@ namespace HelloVulkan
 
 		VkCommandBufferSubmitInfo commandBufferInfo = Vulkan::Init::commandBufferSubmitInfo(currentCommandBuffer);
 
-		VkSemaphoreSubmitInfo waitSemaphoreSubmitInfo = Vulkan::Init::semaphoreSubmitInfo(
-			Frame().ImageAvailableSemaphore, 
-			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR);
+		VkSemaphoreSubmitInfo waitSemaphoreSubmitInfos[] =
+		{
+			Vulkan::Init::semaphoreSubmitInfo(
+				Frame().ImageAvailableSemaphore,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR),
+			// Only the present pass samples the background
+			Vulkan::Init::semaphoreSubmitInfo(
+				_computeTimeline,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT),
+		};
+		waitSemaphoreSubmitInfos[1].value = backgroundValue;
 
 		VkSemaphoreSubmitInfo signalSemaphoreSubmitInfo = Vulkan::Init::semaphoreSubmitInfo(
 			Frame().RenderFinishedSemaphore,
 			VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
 
-		VkSubmitInfo2 submitInfo2 = Vulkan::Init::submitInfo2(commandBufferInfo, &waitSemaphoreSubmitInfo,  &signalSemaphoreSubmitInfo);
+		VkSubmitInfo2 submitInfo2 = Vulkan::Init::submitInfo2(commandBufferInfo, waitSemaphoreSubmitInfos, &signalSemaphoreSubmitInfo, 2);
 
 		VK_CHECK(vkQueueSubmit2(_graphicsQueue, 1, &submitInfo2, Frame().Fence));
 
@@ -778,13 +1545,52 @@ namespace HelloVulkan
 		_currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	}
 
-	void App::DrawImgui(VkCommandBuffer commandBuffer, VkImageView targetImageView)
+	void App::DrawPresent(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 	{
-		VkRenderingAttachmentInfo colorAttachment = Vulkan::Init::colorAttachmentInfo(targetImageView, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		// The triangle covers every pixel, the previous contents are never loaded
+		VkRenderingAttachmentInfo colorAttachment = Vulkan::Init::colorAttachmentInfo(_swapChainImageViews[imageIndex], nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
 		VkRenderingInfo renderInfo = Vulkan::Init::renderingInfo(_swapChainExtent, &colorAttachment, nullptr);
 
 		vkCmdBeginRendering(commandBuffer, &renderInfo);
 
+		VkViewport viewport
+		{
+			.x = 0,
+			.y = 0,
+			.width = float(_swapChainExtent.width),
+			.height = float(_swapChainExtent.height),
+			.minDepth = 0.0f,
+			.maxDepth = 1.0f,
+		};
+
+		VkRect2D scissor
+		{
+			.offset = { 0, 0 },
+			.extent = _swapChainExtent,
+		};
+
+		PresentPushConstants pushConstants
+		{
+			.UvScale =
+			{
+				(float)_drawImageExtent.width / (float)_drawImage.ImageExtent.width,
+				(float)_drawImageExtent.height / (float)_drawImage.ImageExtent.height,
+			},
+			.Exposure = _exposure,
+			.Tonemapper = (uint32_t)_tonemapper,
+			.DitherStrength = _ditherStrength,
+			.Frame = (uint32_t)_snapshot->Frame,
+		};
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _presentPipeline);
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _presentPipelineLayout, 0, 1, &Frame().PresentDescriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, _presentPipelineLayout, _presentPushConstantStages, 0, sizeof(PresentPushConstants), &pushConstants);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
 		ImDrawData* data = ImGui::GetDrawData();
 		ImGui_ImplVulkan_RenderDrawData(data, commandBuffer);
 
@@ -802,57 +1608,122 @@ namespace HelloVulkan
 
 		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
-		Vulkan::Image::transitionImage(commandBuffer, _drawImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
-
-		DrawBackground(commandBuffer);
+		namespace States = Vulkan::Common::ResourceStates;
 
-		Vulkan::Image::transitionImage(commandBuffer, _drawImage.Image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		_renderGraph.Reset();
 
-		Vulkan::Image::transitionImage(commandBuffer, _depthImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+		auto drawImage = _renderGraph.ImportImage("Draw", _drawImage.Image, _drawImage.ImageView);
 
-		DrawGeometry(commandBuffer);
-
-		Vulkan::Image::transitionImage(commandBuffer, _drawImage.Image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		auto depthImage = _renderGraph.CreateImage("Depth",
+			{
+				.Format = DEPTH_FORMAT,
+				.Extent = { _drawImage.ImageExtent.width, _drawImage.ImageExtent.height },
+				.Usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			}
+		);
 
-		Vulkan::Image::transitionImage(commandBuffer, _swapChainImages[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		auto swapchainImage = _renderGraph.ImportImage("Swapchain",
+			_swapChainImages[imageIndex],
+			_swapChainImageViews[imageIndex],
+			States::SwapchainAcquire,
+			States::Present);
 
-		Vulkan::Image::copyImage(commandBuffer, _drawImage.Image, _swapChainImages[imageIndex], _drawImageExtent, _swapChainExtent);
+		_renderGraph.AddPass("Background")
+			.Write(drawImage, States::ClearWrite, true)
+			.Execute([this](VkCommandBuffer cmd) { DrawBackground(cmd); });
 
-		Vulkan::Image::transitionImage(commandBuffer, _swapChainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		_renderGraph.AddPass("Geometry")
+			.Write(drawImage, States::ColorAttachment)
+			.Write(depthImage, States::DepthAttachment, true)
+			.Execute([this, depthImage](VkCommandBuffer cmd) { DrawGeometry(cmd, _renderGraph.GetImageView(depthImage)); });
 
-		DrawImgui(commandBuffer, _swapChainImageViews[imageIndex]);
+		// Tonemapping, upscaling and ImGui share one rendering scope on the swapchain
+		_renderGraph.AddPass("Present")
+			.Read(drawImage, States::FragmentShaderRead)
+			.Write(swapchainImage, States::ColorAttachment, true)
+			.Execute([this, imageIndex](VkCommandBuffer cmd) { DrawPresent(cmd, imageIndex); });
 
-		Vulkan::Image::transitionImage(commandBuffer, _swapChainImages[imageIndex], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		_renderGraph.Compile(Frame().DeletionQueue);
+		_renderGraph.Execute(commandBuffer);
 
 		VK_CHECK(vkEndCommandBuffer(commandBuffer));
 	}
 
 	void App::DrawBackground(VkCommandBuffer commandBuffer)
 	{
-		VkClearColorValue clearColor = { {0.007f, 0.007f, 0.007f, 1.0f} };
+		// Transparent where no geometry lands, the present pass composites the compute background there
+		VkClearColorValue clearColor = { {0.0f, 0.0f, 0.0f, 0.0f} };
 		VkImageSubresourceRange clearRange = Vulkan::Init::imageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
 
 		vkCmdClearColorImage(commandBuffer, _drawImage.Image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &clearRange);
+	}
+
+	uint64_t App::SubmitBackground()
+	{
+		VkCommandBuffer commandBuffer = Frame().ComputeCommandBuffer;
+
+		VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
+
+		VkCommandBufferBeginInfo beginInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		};
+
+		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+		// The frame fence guarantees the previous present pass sampling this image has finished
+		Vulkan::Common::BarrierBuilder barriers;
+		barriers
+			.Image(Frame().Background.Image, Vulkan::Common::ResourceStates::Undefined, Vulkan::Common::ResourceStates::ComputeWrite, true)
+			.Flush(commandBuffer);
 
-		/*ComputeEffect& effect = _backgroundEffects[_currentBackgroundEffect];
+		ComputeEffect& effect = _backgroundEffects[_currentBackgroundEffect];
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, effect.Pipeline);
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &Frame().DescriptorSet, 0, nullptr);
 
 		vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ComputePushConstants), &effect.Data);
 
-		vkCmdDispatch(commandBuffer, _drawImageExtent.width / 16, _drawImageExtent.height / 16, 1);*/
+		DispatchBackground(commandBuffer, effect.WorkgroupSize, _drawImageExtent);
+
+		VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+		uint64_t value = ++_computeTimelineValue;
+
+		VkCommandBufferSubmitInfo commandBufferInfo = Vulkan::Init::commandBufferSubmitInfo(commandBuffer);
+
+		VkSemaphoreSubmitInfo signalSemaphoreSubmitInfo = Vulkan::Init::semaphoreSubmitInfo(
+			_computeTimeline,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		signalSemaphoreSubmitInfo.value = value;
+
+		VkSubmitInfo2 submitInfo2 = Vulkan::Init::submitInfo2(commandBufferInfo, nullptr, &signalSemaphoreSubmitInfo);
+
+		VK_CHECK(vkQueueSubmit2(_computeQueue, 1, &submitInfo2, VK_NULL_HANDLE));
+
+		return value;
+	}
+
+	void App::DispatchBackground(VkCommandBuffer commandBuffer, const std::array<uint32_t, 3>& workgroupSize, VkExtent2D extent)
+	{
+		vkCmdDispatch(commandBuffer,
+			(extent.width + workgroupSize[0] - 1) / workgroupSize[0],
+			(extent.height + workgroupSize[1] - 1) / workgroupSize[1],
+			1);
 	}
 
-	void App::DrawGeometry(VkCommandBuffer commandBuffer)
+	void App::DrawGeometry(VkCommandBuffer commandBuffer, VkImageView depthImageView)
 	{
+		BuildDrawList();
+
 		VkRenderingAttachmentInfo colorAttachment = Vulkan::Init::colorAttachmentInfo(
 			_drawImage.ImageView, 
 			nullptr, 
 			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
 		VkRenderingAttachmentInfo depthAttachment = Vulkan::Init::depthAttachmentInfo(
-			_depthImage.ImageView,
+			depthImageView,
 			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
 
 		VkRenderingInfo renderInfo = Vulkan::Init::renderingInfo(
@@ -860,58 +1731,206 @@ namespace HelloVulkan
 			&colorAttachment, 
 			&depthAttachment);
 
-		vkCmdBeginRendering(commandBuffer, &renderInfo);
+		// Resolved once so every secondary records with the same pipeline, even if it finishes meanwhile
+		VkPipeline pipeline = _meshPipeline->Get();
+		Renderer::ShaderObject meshShaderObject = _meshShaderObject;
+		const Renderer::ShaderObject* shaderObject = _useShaderObjects ? &meshShaderObject : nullptr;
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _meshPipeline);
+		uint32_t drawCount = (shaderObject != nullptr || pipeline != VK_NULL_HANDLE) ? (uint32_t)_drawList.size() : 0;
+		if (drawCount < PARALLEL_RECORD_THRESHOLD)
+		{
+			vkCmdBeginRendering(commandBuffer, &renderInfo);
+			RecordDraws(commandBuffer, pipeline, shaderObject, 0, drawCount);
+			vkCmdEndRendering(commandBuffer);
+			return;
+		}
 
-		VkViewport viewport
+		VkCommandBufferInheritanceRenderingInfo inheritanceInfo
 		{
-			.x = 0,
-			.y = 0,
-			.width = float(_drawImageExtent.width),
-			.height = float(_drawImageExtent.height),
-			.minDepth = 0.f,
-			.maxDepth = 1.f,
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+			.colorAttachmentCount = 1,
+			.pColorAttachmentFormats = &_drawImage.ImageFormat,
+			.depthAttachmentFormat = DEPTH_FORMAT,
+			.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
 		};
 
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		std::vector<VkCommandBuffer> secondaries = _recorder.Record(inheritanceInfo, drawCount, 
+			[this, pipeline, shaderObject](VkCommandBuffer cmd, uint32_t begin, uint32_t end)
+			{
+				RecordDraws(cmd, pipeline, shaderObject, begin, end);
+			}
+		);
 
-		VkRect2D scissor
+		renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+		vkCmdBeginRendering(commandBuffer, &renderInfo);
+		vkCmdExecuteCommands(commandBuffer, (uint32_t)secondaries.size(), secondaries.data());
+		vkCmdEndRendering(commandBuffer);
+	}
+
+	void App::BuildDrawList()
+	{
+		_drawList.clear();
+
+		const auto& mesh = _testMeshes[_currentMesh];
+		uint32_t side = (uint32_t)std::ceil(std::sqrt((float)_meshCopies));
+		float spacing = 3.0f;
+
+		glm::vec3 eye = glm::vec3{ 0, 0, -5 - spacing * (side - 1) } + _snapshot->CameraOffset;
+		glm::mat4 view = glm::lookAt(eye, eye + glm::vec3{ 0, 0, 1 }, glm::vec3{ 0, 1, 0 });
+		glm::mat4 projection = glm::perspective(glm::radians(45.f), (float)_drawImageExtent.width / (float)_drawImageExtent.height, 0.1f, 10000.f);
+		projection[1][1] *= -1;
+
+		glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), glm::radians(_snapshot->Rotation), glm::vec3(0, 1, 0));
+
+		size_t surfaceCount = mesh->Surfaces.size();
+		_drawList.resize(_meshCopies * surfaceCount);
+
+		std::vector<uint8_t> visible(_drawList.size());
+
+		_jobSystem.ParallelFor((uint32_t)_meshCopies, 64, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; i++)
+				{
+					glm::vec3 offset
+					{
+						(float(i % side) - (side - 1) * 0.5f) * spacing,
+						(float(i / side) - (side - 1) * 0.5f) * spacing,
+						0.0f
+					};
+
+					glm::mat4 transform = projection * view * glm::translate(glm::mat4(1.0f), offset) * rotate;
+
+					for (size_t s = 0; s < surfaceCount; s++)
+					{
+						const auto& surface = mesh->Surfaces[s];
+						size_t index = i * surfaceCount + s;
+
+						_drawList[index] =
+						{
+							.IndexCount = surface.Count,
+							.FirstIndex = surface.StartIndex,
+							.IndexBuffer = mesh->MeshBuffers.IndexBuffer.Buffer,
+							.Transform = transform,
+							.VertexBufferAddress = mesh->MeshBuffers.VertexBufferAddress,
+							.Bounds = surface.Bounds,
+						};
+						visible[index] = IsVisible(_drawList[index]);
+					}
+				}
+			}
+		);
+
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < _drawList.size(); i++)
 		{
-			.offset
+			if (visible[i])
 			{
-				.x = 0,
-				.y = 0
-			},
-			.extent
+				_drawList[visibleCount++] = _drawList[i];
+			}
+		}
+
+		_culledDraws = (uint32_t)(_drawList.size() - visibleCount);
+		_drawList.resize(visibleCount);
+	}
+
+	bool App::IsVisible(const RenderObject& object)
+	{
+		// Projects the corners of the bounding box and rejects it if all of them fall outside the same clip plane
+		glm::vec3 min = glm::vec3(1.5f);
+		glm::vec3 max = glm::vec3(-1.5f);
+
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 sign
 			{
-				.width = _drawImageExtent.width,
-				.height = _drawImageExtent.height,
+				(corner & 1) ? 1.0f : -1.0f,
+				(corner & 2) ? 1.0f : -1.0f,
+				(corner & 4) ? 1.0f : -1.0f,
+			};
+
+			glm::vec4 clip = object.Transform * glm::vec4(object.Bounds.Origin + sign * object.Bounds.Extents, 1.0f);
+
+			// A corner behind the camera makes the projection meaningless, keep the object
+			if (clip.w <= 0.0f)
+			{
+				return true;
 			}
-		};
 
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			min = glm::min(min, ndc);
+			max = glm::max(max, ndc);
+		}
 
-		glm::mat4 view = glm::lookAt(glm::vec3{ 0, 0, -5 }, glm::vec3{ 0, 0, 0 }, glm::vec3{ 0, 1, 0 });
-		glm::mat4 projection = glm::perspective(glm::radians(45.f), (float)_drawImageExtent.width / (float)_drawImageExtent.height, 0.1f, 10000.f);
-		projection[1][1] *= -1;
+		return !(min.z > 1.0f || max.z < 0.0f || min.x > 1.0f || max.x < -1.0f || min.y > 1.0f || max.y < -1.0f);
+	}
 
-		static float rotation = 0.0f;
-		glm::mat4 model = projection * glm::rotate(view, glm::radians(rotation), glm::vec3(0, 1, 0));
-		rotation += 0.1f;
+	void App::RecordDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, const Renderer::ShaderObject* shaderObject, uint32_t begin, uint32_t end)
+	{
+		if (begin == end)
+		{
+			return;
+		}
 
-		Vulkan::GPUDrawPushConstants pushConstants
+		// Secondaries inherit no state, each one sets all of it
+		if (shaderObject != nullptr)
 		{
-			.ModelMatrix = model,
-			.VertexBuffer = _testMeshes[_currentMesh]->MeshBuffers.VertexBufferAddress
-		};
+			_shaderObjects.Bind(commandBuffer, *shaderObject);
+			_shaderObjects.SetState(commandBuffer, _meshState, _drawImageExtent);
+		}
+		else
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-		vkCmdPushConstants(commandBuffer, _meshPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Vulkan::GPUDrawPushConstants), &pushConstants);
-		vkCmdBindIndexBuffer(commandBuffer, _testMeshes[_currentMesh]->MeshBuffers.IndexBuffer.Buffer, 0, VK_INDEX_TYPE_UINT32);
+			VkViewport viewport
+			{
+				.x = 0,
+				.y = 0,
+				.width = float(_drawImageExtent.width),
+				.height = float(_drawImageExtent.height),
+				.minDepth = 0.f,
+				.maxDepth = 1.f,
+			};
 
-		vkCmdDrawIndexed(commandBuffer, _testMeshes[_currentMesh]->Surfaces[0].Count, 1, _testMeshes[_currentMesh]->Surfaces[0].StartIndex, 0, 0);
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-		vkCmdEndRendering(commandBuffer);
+			VkRect2D scissor
+			{
+				.offset
+				{
+					.x = 0,
+					.y = 0
+				},
+				.extent
+				{
+					.width = _drawImageExtent.width,
+					.height = _drawImageExtent.height,
+				}
+			};
+
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		}
+
+		VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const RenderObject& object = _drawList[i];
+
+			Vulkan::GPUDrawPushConstants pushConstants
+			{
+				.ModelMatrix = object.Transform,
+				.VertexBuffer = object.VertexBufferAddress,
+			};
+
+			vkCmdPushConstants(commandBuffer, _meshPipelineLayout, _meshPushConstantStages, 0, sizeof(Vulkan::GPUDrawPushConstants), &pushConstants);
+
+			if (object.IndexBuffer != boundIndexBuffer)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, object.IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				boundIndexBuffer = object.IndexBuffer;
+			}
+
+			vkCmdDrawIndexed(commandBuffer, object.IndexCount, 1, object.FirstIndex, 0, 0);
+		}
 	}
 
 	void App::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
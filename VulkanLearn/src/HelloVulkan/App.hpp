@@ -12,12 +12,29 @@
 #include <vma/vk_mem_alloc.h>
 
 #include "../Engine/Camera.hpp"
+#include "../Engine/FrameLimiter.hpp"
+#include "../Engine/Simulation.hpp"
 #include "../Vulkan/Common/DeletionQueue.hpp"
 #include "../Vulkan/Common/DescriptorAllocator.hpp"
 #include "../Vulkan/Common/DescriptorLayoutBuilder.hpp"
+#include "../Vulkan/Common/DescriptorUpdateTemplate.hpp"
+#include "../Vulkan/Common/ComputePipelineBuilder.hpp"
 #include "../Vulkan/Pipeline.hpp"
 #include "../Vulkan/Loader.hpp"
 #include "../Renderer/Shader.hpp"
+#include "../Common/JobSystem.hpp"
+#include "../Renderer/RenderGraph.hpp"
+#include "../Renderer/ParallelRecorder.hpp"
+#include "../Renderer/PipelineCache.hpp"
+#include "../Renderer/ShaderCompiler.hpp"
+#include "../Renderer/ShaderVariants.hpp"
+#include "../Renderer/ShaderBundle.hpp"
+#include "../Renderer/ShaderWatcher.hpp"
+#include "../Renderer/LayoutCache.hpp"
+#include "../Renderer/GraphicsPipelineCache.hpp"
+#include "../Renderer/AsyncPipelineCompiler.hpp"
+#include "../Renderer/ShaderObjectBackend.hpp"
+#include "../Renderer/WorkgroupTuner.hpp"
 
 namespace HelloVulkan
 {
@@ -29,6 +46,27 @@ namespace HelloVulkan
 		glm::vec4 Data4;
 	};
 
+	struct PresentPushConstants
+	{
+		glm::vec2 UvScale;
+		float Exposure;
+		uint32_t Tonemapper;
+		float DitherStrength;
+		uint32_t Frame;
+	};
+
+	// Frame sets written through update templates, one member per binding
+	struct BackgroundDescriptors
+	{
+		VkDescriptorImageInfo Image;
+	};
+
+	struct PresentDescriptors
+	{
+		VkDescriptorImageInfo DrawImage;
+		VkDescriptorImageInfo Background;
+	};
+
 	struct ComputeEffect {
 		const char* Name;
 
@@ -36,6 +74,9 @@ namespace HelloVulkan
 		VkPipelineLayout Layout;
 
 		ComputePushConstants Data;
+
+		// Specialized into the pipeline, the dispatch is sized with it
+		std::array<uint32_t, 3> WorkgroupSize;
 	};
 
 	struct Image
@@ -47,15 +88,37 @@ namespace HelloVulkan
 		VkFormat ImageFormat;
 	};
 
+	struct RenderObject
+	{
+		uint32_t IndexCount;
+		uint32_t FirstIndex;
+		VkBuffer IndexBuffer;
+		glm::mat4 Transform;
+		VkDeviceAddress VertexBufferAddress;
+		Vulkan::Loader::Bounds Bounds;
+	};
+
 	struct Frame 
 	{
 		VkCommandPool CommandPool;
 		VkCommandBuffer CommandBuffer;
 
+		VkCommandPool ComputeCommandPool;
+		VkCommandBuffer ComputeCommandBuffer;
+
 		VkSemaphore ImageAvailableSemaphore;
 		VkSemaphore RenderFinishedSemaphore;
 		VkFence Fence;
 
+		// Written on the compute queue, sampled by the present pass of the same frame
+		Image Background = {};
+
+		// Transient sets of the frame, reset all at once after the frame fence is waited
+		Vulkan::Common::DescriptorAllocator Descriptors;
+		// Allocated and written again every frame, they always point to the current images
+		VkDescriptorSet DescriptorSet;
+		VkDescriptorSet PresentDescriptorSet;
+
 		Vulkan::Common::DeletionQueue DeletionQueue;
 	};
 
@@ -74,10 +137,29 @@ namespace HelloVulkan
 
 		void Run();
 
+		// Compiles every shader stage and variant into a bundle, no window or device needed
+		static bool CookShaders(const std::filesystem::path& output);
+
 	public:
 		static const uint32_t WIDTH = 1200;
 		static const uint32_t HEIGHT = 800;
 		static const size_t MAX_FRAMES_IN_FLIGHT = 2;
+		static const VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+		static const uint32_t PARALLEL_RECORD_THRESHOLD = 256;
+
+		inline static const char* CACHE_DIRECTORY = "cache";
+		inline static const char* SHADER_DIRECTORY = "assets/shaders";
+
+		inline static const char* COMPUTE_SHADER_PATH = "assets/shaders/shader.comp";
+		inline static const char* MESH_VERTEX_SHADER_PATH = "assets/shaders/triangle.vert";
+		inline static const char* MESH_FRAGMENT_SHADER_PATH = "assets/shaders/triangle.frag";
+		inline static const char* MESH_KEYWORD_SHOW_UV = "SHOW_UV";
+		inline static const std::vector<std::string> MESH_KEYWORDS = { MESH_KEYWORD_SHOW_UV };
+
+		// Written by --cook, read instead of compiling when built with VL_USE_SHADER_BUNDLE
+		inline static const char* SHADER_BUNDLE_PATH = "assets/shaders.bundle";
+		inline static const char* PRESENT_VERTEX_SHADER_PATH = "assets/shaders/present.vert";
+		inline static const char* PRESENT_FRAGMENT_SHADER_PATH = "assets/shaders/present.frag";
 
 		const std::string MODEL_PATH = "assets/models/viking_room.obj";
 		const std::string TEXTURE_PATH = "assets/textures/viking_room.png";
@@ -85,8 +167,10 @@ namespace HelloVulkan
 	public:
 		inline void SetResized(bool resized, uint32_t width, uint32_t height);
 		void OnScroll(double yoffset);
+		void OnKey(int key, int action);
 
 		inline Frame& Frame() { return _frames[_currentFrame]; }
+		inline Common::JobSystem& Jobs() { return _jobSystem; }
 
 		Vulkan::GPUMeshBuffers UploadMesh(std::span<uint32_t> indices, std::span<Vulkan::Vertex> vertices);
 
@@ -101,22 +185,55 @@ namespace HelloVulkan
 		void OnRender();
 
 		void CreateSwapChain();
+		void CreateDrawImage(uint32_t width, uint32_t height);
+		Image AllocateImage(VkFormat format, VkImageUsageFlags usage, VkExtent3D extent, bool sharedWithCompute = false);
+		void DestroyImage(const Image& image);
 		void CreateCommands();
 		void CreateSyncObjects();
 		void RecreateSwapChain();
 		void CleanUpSwapChain();
+		void RetireResource(std::function<void()>&& destroy);
 		void CreateDescriptors();
-		void CreatePipeline();
+		void AllocateFrameDescriptors(HelloVulkan::Frame& frame);
+		void CreatePipeline(const Renderer::ShaderFuture& computeShader);
+		// Effects without a stored size for this device and shader are timed at every candidate size
+		void TuneBackgroundEffects();
 		void InitializeImgui();
 		void CreateMeshPipeline();
+		void SetMeshKeywords(Renderer::ShaderKeywordMask keywords);
+		// The previous objects are destroyed once no frame in flight uses them
+		void SwapMeshShaderObject(const Renderer::ShaderObject& shaderObject);
+		void CreatePresentPipeline(const Renderer::ShaderFuture& vertexShader, const Renderer::ShaderFuture& fragmentShader);
+
+		// Safe from worker threads, they only read state that is fixed after InitVulkan and the caches lock themselves
+		VkPipeline BuildComputePipeline(const Renderer::ComputeShader& shader, const std::array<uint32_t, 3>& workgroupSize) const;
+		Renderer::AsyncPipelinePtr RequestMeshPipeline(const std::shared_ptr<Renderer::Shader>& shader, VkFormat colorFormat, VkPipeline fallback);
+		// Empty when the device has no shader objects
+		Renderer::ShaderObject CreateMeshShaderObject(const Renderer::Shader& shader);
+		VkPipeline BuildPresentPipeline(const Renderer::Shader& shader, VkFormat colorFormat);
+
+		void ScheduleShaderReload();
+		void ReloadShaders(
+			const std::vector<std::filesystem::path>& changed,
+			VkFormat drawFormat,
+			VkFormat swapChainFormat,
+			Renderer::ShaderKeywordMask meshKeywords);
+		void CheckReloadedLayout(const Renderer::ShaderReflection& reflection, VkPipelineLayout current);
 
 		void DrawFrame();
-		void DrawImgui(VkCommandBuffer commandBuffer, VkImageView targetImageView);
+		void DrawPresent(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
 		void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
 		void DrawBackground(VkCommandBuffer commandBuffer);
-		void DrawGeometry(VkCommandBuffer commandBuffer);
+		// Rounded up, the shader discards the invocations of a partial tile
+		void DispatchBackground(VkCommandBuffer commandBuffer, const std::array<uint32_t, 3>& workgroupSize, VkExtent2D extent);
+		uint64_t SubmitBackground();
+		void DrawGeometry(VkCommandBuffer commandBuffer, VkImageView depthImageView);
+		void BuildDrawList();
+		static bool IsVisible(const RenderObject& object);
+		// shaderObject: drawn with shader objects and dynamic state instead of the pipeline when set
+		void RecordDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, const Renderer::ShaderObject* shaderObject, uint32_t begin, uint32_t end);
 
 		void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
 
@@ -138,10 +255,18 @@ namespace HelloVulkan
 		uint32_t _graphicsQueueFamilyIndex = 0;
 		VkQueue _presentQueue = VK_NULL_HANDLE;
 		uint32_t _presentQueueFamilyIndex = 0;
+		VkQueue _computeQueue = VK_NULL_HANDLE;
+		uint32_t _computeQueueFamilyIndex = 0;
+
+		// Signaled by every compute submit, the graphics submit of the frame waits on its value
+		VkSemaphore _computeTimeline = VK_NULL_HANDLE;
+		uint64_t _computeTimelineValue = 0;
 
 		VkSwapchainKHR _swapChain = VK_NULL_HANDLE;
 		VkFormat _swapChainImageFormat = VK_FORMAT_UNDEFINED;
 		VkExtent2D _swapChainExtent = {};
+		VkPresentModeKHR _presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+		VkPresentModeKHR _activePresentMode = VK_PRESENT_MODE_FIFO_KHR;
 		std::vector<VkImage> _swapChainImages;
 		std::vector<VkImageView> _swapChainImageViews;
 
@@ -155,20 +280,41 @@ namespace HelloVulkan
 		float _lastFrame = 0.0f;
 		double _fps = 0.0f;
 
+		Engine::Simulation _simulation;
+		Engine::SceneSnapshotPtr _snapshot;
+
+		Engine::FrameLimiter _frameLimiter;
+		int _fpsLimit = 0;
+
+		Common::JobSystem _jobSystem;
+		std::vector<Common::JobThreadStats> _jobStats;
+
 		Vulkan::Common::DeletionQueue DeletionQueue;
 		VmaAllocator _allocator = nullptr;
 
 		Image _drawImage = {};
 		VkExtent2D _drawImageExtent = {};
 
-		Image _depthImage;
+		Renderer::RenderGraph _renderGraph;
+		Renderer::PipelineCache _pipelineCache;
+		Renderer::ShaderBundle _shaderBundle;
+		Renderer::ShaderCompiler _shaderCompiler;
+		Renderer::LayoutCache _layoutCache;
+		Renderer::GraphicsPipelineCache _graphicsPipelines;
+		Renderer::AsyncPipelineCompiler _asyncPipelines;
+		Renderer::ShaderWatcher _shaderWatcher;
+		// Scan and rebuild of the current reload, a new scan waits until it is done
+		Common::JobCounterPtr _shaderReload;
 
-		Vulkan::Common::DescriptorAllocator _descriptorAllocator = {};
-		VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
 		VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout _presentDescriptorSetLayout = VK_NULL_HANDLE;
+		Vulkan::Common::DescriptorUpdateTemplate _backgroundDescriptorTemplate;
+		Vulkan::Common::DescriptorUpdateTemplate _presentDescriptorTemplate;
+		VkSampler _drawImageSampler = VK_NULL_HANDLE;
 
 		std::shared_ptr<Renderer::ComputeShader> _computeShader;
 		std::vector<ComputeEffect> _backgroundEffects;
+		Renderer::WorkgroupTuner _workgroupTuner;
 		int _currentBackgroundEffect = 0;
 
 		VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
@@ -179,10 +325,36 @@ namespace HelloVulkan
 
 		std::shared_ptr<Renderer::Shader> _vertexShader;
 		std::shared_ptr<Renderer::Shader> _fragmentShader;
+		Renderer::ShaderVariantCache _meshVariants;
+		// Variant being drawn, changed from the UI
+		Renderer::ShaderKeywordMask _meshKeywords = 0;
+		Common::JobCounterPtr _meshVariantSwitch;
 		VkPipelineLayout _meshPipelineLayout;
-		VkPipeline _meshPipeline;
+		// Every stage of the layout's push constant range, pushes have to name all of them
+		VkShaderStageFlags _meshPushConstantStages = 0;
+		Renderer::AsyncPipelinePtr _meshPipeline;
+
+		Renderer::ShaderObjectBackend _shaderObjects;
+		Renderer::DynamicGraphicsState _meshState;
+		Renderer::ShaderObject _meshShaderObject = {};
+		// Starts enabled with VL_SHADER_OBJECTS, toggled from the UI
+		bool _useShaderObjects = false;
+
+		std::shared_ptr<Renderer::Shader> _presentShader;
+		VkPipelineLayout _presentPipelineLayout;
+		VkShaderStageFlags _presentPushConstantStages = 0;
+		VkPipeline _presentPipeline;
+		float _renderScale = 1.0f;
+		float _exposure = 1.0f;
+		int _tonemapper = 2;
+		float _ditherStrength = 1.0f;
 
 		std::vector<std::shared_ptr<Vulkan::Loader::MeshAsset>> _testMeshes;
 		int _currentMesh = 2;
+		int _meshCopies = 1;
+
+		std::vector<RenderObject> _drawList;
+		uint32_t _culledDraws = 0;
+		Renderer::ParallelRecorder _recorder;
 	};
 }
\ No newline at end of file
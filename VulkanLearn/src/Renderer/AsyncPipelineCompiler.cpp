@@ -0,0 +1,63 @@
+#include "AsyncPipelineCompiler.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace Renderer
+{
+	void AsyncPipelineCompiler::Init(Common::JobSystem& jobs, GraphicsPipelineCache& pipelines)
+	{
+		_jobs = &jobs;
+		_pipelines = &pipelines;
+		_counter = _jobs->CreateCounter();
+	}
+
+	AsyncPipelinePtr AsyncPipelineCompiler::Request(
+		const Vulkan::Common::GraphicsPipelineBuilder& builder,
+		const std::shared_ptr<const Shader>& shader,
+		VkPipeline fallback)
+	{
+		auto pipeline = std::make_shared<AsyncPipeline>();
+		pipeline->_fallback = fallback;
+
+		_pending++;
+
+		_jobs->Schedule([this, pipeline, builder = Vulkan::Common::GraphicsPipelineBuilder(builder), shader]()
+			{
+				try
+				{
+					// A fast linked pipeline draws until its optimized link lands, a frame may see either
+					auto onOptimized = [pipeline](VkPipeline optimized)
+					{
+						pipeline->_pipeline.store(optimized, std::memory_order_release);
+					};
+
+					VkPipeline created = _pipelines->GetOrCreate(builder, *shader, onOptimized);
+
+					// The optimized link may have landed before GetOrCreate returned, it is never replaced by the fast one
+					VkPipeline expected = VK_NULL_HANDLE;
+					pipeline->_pipeline.compare_exchange_strong(expected, created, std::memory_order_acq_rel);
+				}
+				catch (const std::exception& e)
+				{
+					spdlog::error("Fallo la compilacion asincrona del pipeline: {0}", e.what());
+					pipeline->_failed.store(true, std::memory_order_release);
+				}
+
+				_pending--;
+			},
+			// Never on the render thread, a driver compile there is the hitch this avoids
+			Common::JobLane::Background,
+			_counter
+		);
+
+		return pipeline;
+	}
+
+	void AsyncPipelineCompiler::Wait()
+	{
+		if (_counter)
+		{
+			_jobs->Wait(_counter);
+		}
+	}
+}
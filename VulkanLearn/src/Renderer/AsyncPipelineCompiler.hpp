@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <atomic>
+#include <vulkan/vulkan.h>
+
+#include "Shader.hpp"
+#include "GraphicsPipelineCache.hpp"
+#include "../Common/JobSystem.hpp"
+#include "../Vulkan/Common/GraphicsPipelineBuilder.hpp"
+
+namespace Renderer
+{
+	// A pipeline that may still be compiling. Draws read Get() every frame and switch over once it is ready.
+	class AsyncPipeline
+	{
+	public:
+		inline bool IsReady() const { return _pipeline.load(std::memory_order_acquire) != VK_NULL_HANDLE; }
+		inline bool HasFailed() const { return _failed.load(std::memory_order_acquire); }
+
+		// The compiled pipeline, otherwise the fallback, which may be VK_NULL_HANDLE to skip the draws
+		inline VkPipeline Get() const
+		{
+			VkPipeline pipeline = _pipeline.load(std::memory_order_acquire);
+			return pipeline != VK_NULL_HANDLE ? pipeline : _fallback;
+		}
+
+	private:
+		friend class AsyncPipelineCompiler;
+
+		std::atomic<VkPipeline> _pipeline = VK_NULL_HANDLE;
+		std::atomic<bool> _failed = false;
+		VkPipeline _fallback = VK_NULL_HANDLE;
+	};
+
+	using AsyncPipelinePtr = std::shared_ptr<AsyncPipeline>;
+
+	// Builds graphics pipelines on the workers through the shared GraphicsPipelineCache,
+	// so a pipeline first needed mid-session never stalls the frame that asks for it.
+	class AsyncPipelineCompiler
+	{
+	public:
+		void Init(Common::JobSystem& jobs, GraphicsPipelineCache& pipelines);
+
+		// The builder is copied and must not have shaders set, the cache creates the modules
+		AsyncPipelinePtr Request(
+			const Vulkan::Common::GraphicsPipelineBuilder& builder,
+			const std::shared_ptr<const Shader>& shader,
+			VkPipeline fallback = VK_NULL_HANDLE);
+
+		// Before the job system or the pipeline cache go away
+		void Wait();
+
+		inline uint32_t GetPendingCount() const { return _pending.load(); }
+
+	private:
+		Common::JobSystem* _jobs = nullptr;
+		GraphicsPipelineCache* _pipelines = nullptr;
+
+		Common::JobCounterPtr _counter;
+		std::atomic<uint32_t> _pending = 0;
+	};
+}
@@ -0,0 +1,280 @@
+#include "GraphicsPipelineCache.hpp"
+
+#include <array>
+#include <chrono>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "../Common/Hash.hpp"
+
+namespace Renderer
+{
+	void GraphicsPipelineCache::Init(VkDevice device, VkPipelineCache cache, Common::JobSystem& jobs, bool useLibraries)
+	{
+		_device = device;
+		_cache = cache;
+		_jobs = &jobs;
+		_useLibraries = useLibraries;
+		_optimizing = _jobs->CreateCounter();
+	}
+
+	void GraphicsPipelineCache::Destroy()
+	{
+		std::lock_guard lock(_mutex);
+
+		for (auto& [key, entry] : _pipelines)
+		{
+			vkDestroyPipeline(_device, entry.Pipeline, nullptr);
+		}
+		_pipelines.clear();
+
+		for (VkPipeline pipeline : _replaced)
+		{
+			vkDestroyPipeline(_device, pipeline, nullptr);
+		}
+		_replaced.clear();
+
+		// Linked pipelines do not reference their libraries once created
+		for (auto& [key, library] : _libraries)
+		{
+			vkDestroyPipeline(_device, library, nullptr);
+		}
+		_libraries.clear();
+	}
+
+	void GraphicsPipelineCache::Wait()
+	{
+		if (_optimizing)
+		{
+			_jobs->Wait(_optimizing);
+		}
+	}
+
+	VkPipeline GraphicsPipelineCache::GetOrCreate(
+		const Vulkan::Common::GraphicsPipelineBuilder& builder,
+		const Shader& shader,
+		const OptimizedCallback& onOptimized)
+	{
+		uint64_t key = Common::Hash::fnv1aValue(shader.GetHash(), builder.Hash());
+
+		{
+			std::lock_guard lock(_mutex);
+
+			auto it = _pipelines.find(key);
+			if (it != _pipelines.end())
+			{
+				_stats.Hits++;
+				if (!it->second.Optimized && onOptimized)
+				{
+					it->second.OnOptimized.push_back(onOptimized);
+				}
+				return it->second.Pipeline;
+			}
+		}
+
+		// Created unlocked, other threads keep getting their pipelines while this one compiles
+		auto start = std::chrono::steady_clock::now();
+
+		std::array<VkPipeline, 4> libraries = {};
+		VkPipeline pipeline = _useLibraries ? CreateLinked(builder, shader, libraries) : CreateMonolithic(builder, shader);
+
+		float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard lock(_mutex);
+
+		auto [it, inserted] = _pipelines.try_emplace(key, Entry{ .Pipeline = pipeline, .Optimized = !_useLibraries });
+
+		// Another thread built the same state meanwhile, keep the first one
+		if (!inserted)
+		{
+			vkDestroyPipeline(_device, pipeline, nullptr);
+			_stats.Hits++;
+		}
+		else
+		{
+			_stats.Pipelines++;
+			_stats.TotalMilliseconds += milliseconds;
+			_stats.MaxMilliseconds = std::max(_stats.MaxMilliseconds, milliseconds);
+
+			spdlog::debug("Pipeline grafico {0} creado en {1:.2f} ms", Common::Hash::toHex(key), milliseconds);
+
+			if (_useLibraries)
+			{
+				ScheduleOptimizedLink(key, libraries, builder.GetPipelineLayout());
+			}
+		}
+
+		if (!it->second.Optimized && onOptimized)
+		{
+			it->second.OnOptimized.push_back(onOptimized);
+		}
+
+		return it->second.Pipeline;
+	}
+
+	VkPipeline GraphicsPipelineCache::CreateMonolithic(const Vulkan::Common::GraphicsPipelineBuilder& builder, const Shader& shader)
+	{
+		// The modules are destroyed below, the caller's builder never sees them
+		Vulkan::Common::GraphicsPipelineBuilder stages(builder);
+
+		VkShaderModule vertexShaderModule = shader.BuildModule(_device, ShaderType::Vertex);
+		VkShaderModule fragmentShaderModule = shader.BuildModule(_device, ShaderType::Fragment);
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		try
+		{
+			pipeline = stages
+				.SetShaders(vertexShaderModule, fragmentShaderModule)
+				.Build(_device, _cache);
+		}
+		catch (...)
+		{
+			vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
+			vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
+			throw;
+		}
+
+		vkDestroyShaderModule(_device, vertexShaderModule, nullptr);
+		vkDestroyShaderModule(_device, fragmentShaderModule, nullptr);
+
+		return pipeline;
+	}
+
+	VkPipeline GraphicsPipelineCache::CreateLinked(const Vulkan::Common::GraphicsPipelineBuilder& builder, const Shader& shader, std::array<VkPipeline, 4>& libraries)
+	{
+		using namespace Common::Hash;
+
+		// Hashed before any shader is set, shaders are keyed by their code. The part bit keeps equal hashes of different parts apart.
+		uint64_t vertexInputKey = fnv1aValue(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, builder.HashVertexInput());
+		uint64_t preRasterizationKey = fnv1aValue(shader.GetStageHash(ShaderType::Vertex), builder.HashPreRasterization());
+		uint64_t fragmentShaderKey = fnv1aValue(shader.GetStageHash(ShaderType::Fragment), builder.HashFragmentShader());
+		uint64_t fragmentOutputKey = fnv1aValue(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, builder.HashFragmentOutput());
+
+		preRasterizationKey = fnv1aValue(VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, preRasterizationKey);
+		fragmentShaderKey = fnv1aValue(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, fragmentShaderKey);
+
+		auto buildShaderLibrary = [&](ShaderType type, VkGraphicsPipelineLibraryFlagsEXT part)
+		{
+			VkShaderModule module = shader.BuildModule(_device, type);
+			Vulkan::Common::GraphicsPipelineBuilder stages(builder);
+
+			VkPipeline library = VK_NULL_HANDLE;
+			try
+			{
+				// BuildLibrary only passes the stage of its part, the other module is never read
+				library = stages
+					.SetShaders(module, module)
+					.BuildLibrary(_device, part, _cache);
+			}
+			catch (...)
+			{
+				vkDestroyShaderModule(_device, module, nullptr);
+				throw;
+			}
+
+			vkDestroyShaderModule(_device, module, nullptr);
+
+			return library;
+		};
+
+		libraries =
+		{
+			GetOrCreateLibrary(vertexInputKey, [&]()
+				{
+					return builder.BuildLibrary(_device, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, _cache);
+				}
+			),
+			GetOrCreateLibrary(preRasterizationKey, [&]()
+				{
+					return buildShaderLibrary(ShaderType::Vertex, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+				}
+			),
+			GetOrCreateLibrary(fragmentShaderKey, [&]()
+				{
+					return buildShaderLibrary(ShaderType::Fragment, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+				}
+			),
+			GetOrCreateLibrary(fragmentOutputKey, [&]()
+				{
+					return builder.BuildLibrary(_device, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, _cache);
+				}
+			),
+		};
+
+		return Vulkan::Common::GraphicsPipelineBuilder::Link(_device, builder.GetPipelineLayout(), libraries, false, _cache);
+	}
+
+	void GraphicsPipelineCache::ScheduleOptimizedLink(uint64_t key, const std::array<VkPipeline, 4>& libraries, VkPipelineLayout layout)
+	{
+		// The libraries outlive the job, they are only destroyed by Destroy after Wait
+		_jobs->Schedule([this, key, libraries, layout]()
+			{
+				VkPipeline optimized = VK_NULL_HANDLE;
+				try
+				{
+					optimized = Vulkan::Common::GraphicsPipelineBuilder::Link(_device, layout, libraries, true, _cache);
+				}
+				catch (const std::exception& e)
+				{
+					spdlog::error("Fallo el enlace optimizado del pipeline {0}, se mantiene el rapido: {1}", Common::Hash::toHex(key), e.what());
+					return;
+				}
+
+				std::vector<OptimizedCallback> callbacks;
+				{
+					std::lock_guard lock(_mutex);
+
+					Entry& entry = _pipelines.at(key);
+					_replaced.push_back(entry.Pipeline);
+					entry.Pipeline = optimized;
+					entry.Optimized = true;
+					callbacks.swap(entry.OnOptimized);
+					_stats.Optimized++;
+				}
+
+				for (const auto& callback : callbacks)
+				{
+					callback(optimized);
+				}
+			},
+			Common::JobLane::Background,
+			_optimizing
+		);
+	}
+
+	VkPipeline GraphicsPipelineCache::GetOrCreateLibrary(uint64_t key, const std::function<VkPipeline()>& create)
+	{
+		{
+			std::lock_guard lock(_mutex);
+
+			auto it = _libraries.find(key);
+			if (it != _libraries.end())
+			{
+				return it->second;
+			}
+		}
+
+		VkPipeline library = create();
+
+		std::lock_guard lock(_mutex);
+
+		auto [it, inserted] = _libraries.try_emplace(key, library);
+		if (!inserted)
+		{
+			vkDestroyPipeline(_device, library, nullptr);
+		}
+		else
+		{
+			_stats.Libraries++;
+		}
+
+		return it->second;
+	}
+
+	GraphicsPipelineStats GraphicsPipelineCache::GetStats()
+	{
+		std::lock_guard lock(_mutex);
+		return _stats;
+	}
+}
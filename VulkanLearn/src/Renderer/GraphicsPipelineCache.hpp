@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+#include "Shader.hpp"
+#include "../Common/JobSystem.hpp"
+#include "../Vulkan/Common/GraphicsPipelineBuilder.hpp"
+
+namespace Renderer
+{
+	struct GraphicsPipelineStats
+	{
+		uint32_t Pipelines;
+		uint32_t Hits;
+		float TotalMilliseconds;
+		float MaxMilliseconds;
+		// Pipeline library path only
+		uint32_t Libraries;
+		uint32_t Optimized;
+	};
+
+	// Owns every graphics pipeline, keyed by the builder state and the shader code.
+	// Asking twice for the same combination returns the first pipeline instead of compiling a duplicate.
+	//
+	// With VK_EXT_graphics_pipeline_library each part of the state is compiled once as a library and shared
+	// by every pipeline that uses it. A miss returns a fast link of the libraries and an optimized link
+	// replaces it in the background.
+	class GraphicsPipelineCache
+	{
+	public:
+		using OptimizedCallback = std::function<void(VkPipeline)>;
+
+		// jobs: runs the optimized links when useLibraries is set
+		void Init(VkDevice device, VkPipelineCache cache, Common::JobSystem& jobs, bool useLibraries);
+		void Destroy();
+
+		// Before the job system goes away
+		void Wait();
+
+		// Safe from any thread. Shader modules are only created on a miss and set on a copy of the builder,
+		// which must not have shaders set and can be reused for the next request.
+		// onOptimized: called once from a worker when a fast linked pipeline gets its optimized replacement.
+		// Both stay valid until Destroy.
+		VkPipeline GetOrCreate(
+			const Vulkan::Common::GraphicsPipelineBuilder& builder,
+			const Shader& shader,
+			const OptimizedCallback& onOptimized = nullptr);
+
+		inline bool UsesLibraries() const { return _useLibraries; }
+
+		GraphicsPipelineStats GetStats();
+
+	private:
+		struct Entry
+		{
+			VkPipeline Pipeline;
+			bool Optimized;
+			std::vector<OptimizedCallback> OnOptimized;
+		};
+
+		VkPipeline CreateMonolithic(const Vulkan::Common::GraphicsPipelineBuilder& builder, const Shader& shader);
+		VkPipeline CreateLinked(const Vulkan::Common::GraphicsPipelineBuilder& builder, const Shader& shader, std::array<VkPipeline, 4>& libraries);
+		// Called with the mutex held, once the fast link is in the map
+		void ScheduleOptimizedLink(uint64_t key, const std::array<VkPipeline, 4>& libraries, VkPipelineLayout layout);
+
+		VkPipeline GetOrCreateLibrary(uint64_t key, const std::function<VkPipeline()>& create);
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPipelineCache _cache = VK_NULL_HANDLE;
+		Common::JobSystem* _jobs = nullptr;
+		bool _useLibraries = false;
+		Common::JobCounterPtr _optimizing;
+
+		std::mutex _mutex;
+		// Keyed on the 64 bit hash alone, the state is not kept to compare on a hit.
+		// A collision would return the wrong pipeline, a risk accepted as for the shader cache.
+		std::unordered_map<uint64_t, Entry> _pipelines;
+		std::unordered_map<uint64_t, VkPipeline> _libraries;
+		// Fast links replaced by their optimized pipeline, callers may still hold them
+		std::vector<VkPipeline> _replaced;
+		GraphicsPipelineStats _stats = {};
+	};
+}
@@ -0,0 +1,139 @@
+#include "LayoutCache.hpp"
+
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "../Vulkan/Types.hpp"
+#include "../Vulkan/Common/DescriptorLayoutBuilder.hpp"
+
+template<typename T>
+static void appendKey(std::string& key, const T& value)
+{
+	key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+namespace Renderer
+{
+	void LayoutCache::Init(VkDevice device)
+	{
+		_device = device;
+	}
+
+	void LayoutCache::Destroy()
+	{
+		std::lock_guard lock(_mutex);
+
+		for (auto& [key, layout] : _pipelineLayouts)
+		{
+			vkDestroyPipelineLayout(_device, layout, nullptr);
+		}
+		for (auto& [key, layout] : _setLayouts)
+		{
+			vkDestroyDescriptorSetLayout(_device, layout, nullptr);
+		}
+
+		_pipelineLayouts.clear();
+		_setLayouts.clear();
+	}
+
+	VkDescriptorSetLayout LayoutCache::GetSetLayout(const ShaderReflection& reflection, uint32_t set)
+	{
+		std::lock_guard lock(_mutex);
+		return FindOrCreateSetLayout(reflection, set);
+	}
+
+	VkPipelineLayout LayoutCache::GetPipelineLayout(const ShaderReflection& reflection)
+	{
+		std::lock_guard lock(_mutex);
+
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		for (uint32_t set = 0; set < reflection.GetSetCount(); set++)
+		{
+			setLayouts.push_back(FindOrCreateSetLayout(reflection, set));
+		}
+
+		// Set layouts are already unique, their handles identify them
+		std::string key;
+		for (VkDescriptorSetLayout setLayout : setLayouts)
+		{
+			appendKey(key, setLayout);
+		}
+		appendKey(key, reflection.PushConstantSize);
+		appendKey(key, reflection.PushConstantStages);
+
+		auto it = _pipelineLayouts.find(key);
+		if (it != _pipelineLayouts.end())
+		{
+			return it->second;
+		}
+
+		VkPushConstantRange pushConstant
+		{
+			.stageFlags = reflection.PushConstantStages,
+			.offset = 0,
+			.size = reflection.PushConstantSize,
+		};
+
+		VkPipelineLayoutCreateInfo layoutInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount = (uint32_t)setLayouts.size(),
+			.pSetLayouts = setLayouts.data(),
+			.pushConstantRangeCount = reflection.PushConstantSize > 0 ? 1u : 0u,
+			.pPushConstantRanges = &pushConstant,
+		};
+
+		VkPipelineLayout layout;
+		VK_CHECK(vkCreatePipelineLayout(_device, &layoutInfo, nullptr, &layout));
+
+		_pipelineLayouts.emplace(std::move(key), layout);
+
+		spdlog::debug("Pipeline layout creado con {0} sets y {1} bytes de push constants", setLayouts.size(), reflection.PushConstantSize);
+
+		return layout;
+	}
+
+	VkDescriptorSetLayout LayoutCache::FindOrCreateSetLayout(const ShaderReflection& reflection, uint32_t set)
+	{
+		Vulkan::Common::DescriptorLayoutBuilder builder;
+		for (const auto& binding : reflection.Bindings)
+		{
+			if (binding.Set != set)
+			{
+				continue;
+			}
+
+			builder.Bindings.push_back(
+				VkDescriptorSetLayoutBinding
+				{
+					.binding = binding.Binding,
+					.descriptorType = binding.Type,
+					.descriptorCount = binding.Count,
+					.stageFlags = binding.Stages,
+				}
+			);
+		}
+
+		// Bindings come sorted from the reflection, equal sets produce equal keys
+		std::string key;
+		for (const auto& binding : builder.Bindings)
+		{
+			appendKey(key, binding.binding);
+			appendKey(key, binding.descriptorType);
+			appendKey(key, binding.descriptorCount);
+			appendKey(key, binding.stageFlags);
+		}
+
+		auto it = _setLayouts.find(key);
+		if (it != _setLayouts.end())
+		{
+			return it->second;
+		}
+
+		VkDescriptorSetLayout layout = builder.Build(_device, 0);
+		_setLayouts.emplace(std::move(key), layout);
+
+		return layout;
+	}
+}
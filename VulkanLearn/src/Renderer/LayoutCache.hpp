@@ -0,0 +1,33 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.hpp"
+
+namespace Renderer
+{
+	// Owns every descriptor set and pipeline layout built from shader reflection.
+	// Identical interfaces return the same handles, so sets bound for one pipeline stay valid for the others.
+	class LayoutCache
+	{
+	public:
+		void Init(VkDevice device);
+		void Destroy();
+
+		// Safe from any thread
+		VkDescriptorSetLayout GetSetLayout(const ShaderReflection& reflection, uint32_t set);
+		VkPipelineLayout GetPipelineLayout(const ShaderReflection& reflection);
+
+	private:
+		VkDescriptorSetLayout FindOrCreateSetLayout(const ShaderReflection& reflection, uint32_t set);
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+
+		std::mutex _mutex;
+		std::unordered_map<std::string, VkDescriptorSetLayout> _setLayouts;
+		std::unordered_map<std::string, VkPipelineLayout> _pipelineLayouts;
+	};
+}
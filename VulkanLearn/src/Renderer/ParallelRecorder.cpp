@@ -0,0 +1,138 @@
+#include "ParallelRecorder.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include "../Vulkan/Types.hpp"
+#include "../Vulkan/Init.hpp"
+
+namespace Renderer
+{
+	void ParallelRecorder::Init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight, Common::JobSystem& jobs)
+	{
+		_device = device;
+		_jobs = &jobs;
+
+		// Workers plus the main thread, which records too while it waits
+		uint32_t threadCount = jobs.GetWorkerCount() + 1;
+
+		VkCommandPoolCreateInfo poolInfo = Vulkan::Init::commandPoolCreateInfo(
+			queueFamilyIndex,
+			VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+		_pools.resize(framesInFlight);
+		for (auto& framePools : _pools)
+		{
+			framePools.resize(threadCount);
+			for (auto& pool : framePools)
+			{
+				VK_CHECK(vkCreateCommandPool(_device, &poolInfo, nullptr, &pool.Pool));
+				pool.Used = 0;
+			}
+		}
+	}
+
+	void ParallelRecorder::Destroy()
+	{
+		for (auto& framePools : _pools)
+		{
+			for (auto& pool : framePools)
+			{
+				vkDestroyCommandPool(_device, pool.Pool, nullptr);
+			}
+		}
+		_pools.clear();
+	}
+
+	void ParallelRecorder::BeginFrame(uint32_t frameIndex)
+	{
+		_frameIndex = frameIndex;
+
+		for (auto& pool : _pools[_frameIndex])
+		{
+			VK_CHECK(vkResetCommandPool(_device, pool.Pool, 0));
+			pool.Used = 0;
+		}
+	}
+
+	std::vector<VkCommandBuffer> ParallelRecorder::Record(
+		const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+		uint32_t count,
+		const RecordFunction& record)
+	{
+		uint32_t chunkCount = std::min(_jobs->GetWorkerCount() + 1, (count + MIN_ITEMS_PER_CHUNK - 1) / MIN_ITEMS_PER_CHUNK);
+		chunkCount = std::max(chunkCount, 1u);
+
+		std::vector<VkCommandBuffer> buffers(chunkCount);
+		std::vector<std::exception_ptr> errors(chunkCount);
+		Common::JobCounterPtr counter = _jobs->CreateCounter();
+
+		VkCommandBufferInheritanceInfo inheritanceInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+			.pNext = &renderingInfo,
+		};
+
+		VkCommandBufferBeginInfo beginInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &inheritanceInfo,
+		};
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			uint32_t begin = (uint32_t)((uint64_t)count * chunk / chunkCount);
+			uint32_t end = (uint32_t)((uint64_t)count * (chunk + 1) / chunkCount);
+
+			_jobs->Schedule([&, chunk, begin, end]()
+				{
+					try
+					{
+						VkCommandBuffer cmd = AcquireSecondary((uint32_t)_jobs->GetThreadIndex());
+
+						VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+						record(cmd, begin, end);
+						VK_CHECK(vkEndCommandBuffer(cmd));
+
+						buffers[chunk] = cmd;
+					}
+					catch (...)
+					{
+						errors[chunk] = std::current_exception();
+					}
+				},
+				Common::JobLane::Worker,
+				counter
+			);
+		}
+
+		_jobs->Wait(counter);
+
+		for (auto& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+
+		return buffers;
+	}
+
+	VkCommandBuffer ParallelRecorder::AcquireSecondary(uint32_t thread)
+	{
+		WorkerPool& pool = _pools[_frameIndex][thread];
+
+		if (pool.Used == pool.Buffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo = Vulkan::Init::commandBufferAllocateInfo(pool.Pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+			VkCommandBuffer cmd;
+			VK_CHECK(vkAllocateCommandBuffers(_device, &allocInfo, &cmd));
+			pool.Buffers.push_back(cmd);
+		}
+
+		return pool.Buffers[pool.Used++];
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <vulkan/vulkan.h>
+
+#include "../Common/JobSystem.hpp"
+
+namespace Renderer
+{
+	// Records a range of work into secondary command buffers on the job system.
+	// Every job thread owns one command pool per frame in flight, so no pool is ever shared between threads.
+	class ParallelRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(VkCommandBuffer cmd, uint32_t begin, uint32_t end)>;
+
+		static const uint32_t MIN_ITEMS_PER_CHUNK = 64;
+
+	public:
+		void Init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight, Common::JobSystem& jobs);
+		void Destroy();
+
+		// Resets the worker pools of the frame, the frame fence must already be signaled
+		void BeginFrame(uint32_t frameIndex);
+
+		// Splits [0, count) across the workers. The returned secondaries are in order and
+		// continue the dynamic rendering scope described by renderingInfo.
+		std::vector<VkCommandBuffer> Record(
+			const VkCommandBufferInheritanceRenderingInfo& renderingInfo,
+			uint32_t count,
+			const RecordFunction& record);
+
+
+	private:
+		struct WorkerPool
+		{
+			VkCommandPool Pool;
+			std::vector<VkCommandBuffer> Buffers;
+			uint32_t Used;
+		};
+
+		VkCommandBuffer AcquireSecondary(uint32_t thread);
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		Common::JobSystem* _jobs = nullptr;
+		uint32_t _frameIndex = 0;
+
+		// [frame][job thread]
+		std::vector<std::vector<WorkerPool>> _pools;
+	};
+}
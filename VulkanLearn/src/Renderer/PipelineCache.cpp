@@ -0,0 +1,128 @@
+#include "PipelineCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "../Common/Utils.hpp"
+#include "../Vulkan/Types.hpp"
+
+namespace Renderer
+{
+	void PipelineCache::Init(VkDevice device, VkPhysicalDevice physicalDevice, const std::filesystem::path& directory)
+	{
+		_device = device;
+		vkGetPhysicalDeviceProperties(physicalDevice, &_properties);
+
+		std::string uuid;
+		for (uint8_t byte : _properties.pipelineCacheUUID)
+		{
+			uuid += fmt::format("{:02x}", byte);
+		}
+
+		_path = directory / fmt::format("pipelines_{:04x}_{:04x}_{}.bin", _properties.vendorID, _properties.deviceID, uuid);
+
+		std::vector<char> data;
+		std::ifstream file(_path, std::ios::ate | std::ios::binary);
+		if (file.is_open())
+		{
+			data.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read(data.data(), data.size());
+		}
+
+		if (!data.empty() && !IsCompatible(data))
+		{
+			spdlog::warn("Cache de pipelines incompatible, se descarta {0}", _path.string());
+			data.clear();
+		}
+
+		VkPipelineCacheCreateInfo cacheInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+			.initialDataSize = data.size(),
+			.pInitialData = data.empty() ? nullptr : data.data(),
+		};
+
+		VK_CHECK(vkCreatePipelineCache(_device, &cacheInfo, nullptr, &_cache));
+
+		_savedSize = data.size();
+		_lastSave = std::chrono::steady_clock::now().time_since_epoch().count();
+
+		if (data.empty())
+		{
+			spdlog::info("Cache de pipelines vacio");
+		}
+		else
+		{
+			spdlog::info("Cache de pipelines cargado ({0} KB)", data.size() / 1024);
+		}
+	}
+
+	void PipelineCache::Destroy()
+	{
+		if (_cache == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		Save();
+
+		vkDestroyPipelineCache(_device, _cache, nullptr);
+		_cache = VK_NULL_HANDLE;
+	}
+
+	void PipelineCache::Save()
+	{
+		std::lock_guard lock(_saveMutex);
+
+		size_t size = 0;
+		VK_CHECK(vkGetPipelineCacheData(_device, _cache, &size, nullptr));
+
+		// Caches only grow, an equal size means nothing new was compiled
+		if (size == _savedSize)
+		{
+			return;
+		}
+
+		std::vector<char> data(size);
+		VK_CHECK(vkGetPipelineCacheData(_device, _cache, &size, data.data()));
+
+		if (Common::Utils::writeFileAtomic(_path, data.data(), size))
+		{
+			_savedSize = size;
+			spdlog::info("Cache de pipelines guardado ({0} KB)", size / 1024);
+		}
+	}
+
+	bool PipelineCache::ConsumeSaveDue()
+	{
+		auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+		auto last = _lastSave.load();
+
+		if (std::chrono::steady_clock::duration(now - last) < SAVE_INTERVAL)
+		{
+			return false;
+		}
+
+		return _lastSave.compare_exchange_strong(last, now);
+	}
+
+	bool PipelineCache::IsCompatible(const std::vector<char>& data) const
+	{
+		VkPipelineCacheHeaderVersionOne header;
+		if (data.size() < sizeof(header))
+		{
+			return false;
+		}
+
+		memcpy(&header, data.data(), sizeof(header));
+
+		return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header.vendorID == _properties.vendorID
+			&& header.deviceID == _properties.deviceID
+			&& memcmp(header.pipelineCacheUUID, _properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
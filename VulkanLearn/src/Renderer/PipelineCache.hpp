@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <vulkan/vulkan.h>
+
+namespace Renderer
+{
+	// VkPipelineCache persisted to disk. The file name carries vendor, device and driver UUID,
+	// so a driver update or another GPU starts from an empty cache instead of a rejected one.
+	class PipelineCache
+	{
+	public:
+		inline static const std::chrono::seconds SAVE_INTERVAL{ 30 };
+
+	public:
+		void Init(VkDevice device, VkPhysicalDevice physicalDevice, const std::filesystem::path& directory);
+		// Saves one last time
+		void Destroy();
+
+		// Safe from any thread, pipeline creation may continue meanwhile
+		void Save();
+
+		// True once SAVE_INTERVAL has passed, restarts the interval so only one caller schedules the save
+		bool ConsumeSaveDue();
+
+		inline VkPipelineCache Get() const { return _cache; }
+
+	private:
+		bool IsCompatible(const std::vector<char>& data) const;
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkPipelineCache _cache = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties _properties = {};
+		std::filesystem::path _path;
+
+		std::mutex _saveMutex;
+		size_t _savedSize = 0;
+		std::atomic<std::chrono::steady_clock::rep> _lastSave = 0;
+	};
+}
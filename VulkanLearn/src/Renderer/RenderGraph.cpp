@@ -0,0 +1,666 @@
+#include "RenderGraph.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "../Vulkan/Init.hpp"
+
+static VkImageAspectFlags aspectFromFormat(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+namespace Renderer
+{
+	RenderGraph::Pass& RenderGraph::Pass::Read(RenderGraphResource resource, const Vulkan::Common::ResourceState& state)
+	{
+		_accesses.push_back({ resource, state, false, false });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::Write(RenderGraphResource resource, const Vulkan::Common::ResourceState& state, bool discard)
+	{
+		_accesses.push_back({ resource, state, true, discard });
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::SideEffect()
+	{
+		_sideEffect = true;
+		return *this;
+	}
+
+	RenderGraph::Pass& RenderGraph::Pass::Execute(std::function<void(VkCommandBuffer)>&& function)
+	{
+		_execute = std::move(function);
+		return *this;
+	}
+
+	void RenderGraph::Init(VkDevice device, VmaAllocator allocator)
+	{
+		_device = device;
+		_allocator = allocator;
+	}
+
+	void RenderGraph::Destroy()
+	{
+		for (auto& transient : _transients)
+		{
+			vkDestroyImageView(_device, transient.View, nullptr);
+			vkDestroyImage(_device, transient.Image, nullptr);
+			vkDestroyBuffer(_device, transient.Buffer, nullptr);
+		}
+
+		for (auto& slot : _slots)
+		{
+			vmaFreeMemory(_allocator, slot.Allocation);
+		}
+
+		_transients.clear();
+		_slots.clear();
+		_importedStates.clear();
+		_importedBufferStates.clear();
+
+		Reset();
+	}
+
+	void RenderGraph::Reset()
+	{
+		_resources.clear();
+		_passes.clear();
+	}
+
+	RenderGraphResource RenderGraph::ImportImage(
+		const std::string& name,
+		VkImage image,
+		VkImageView view,
+		std::optional<Vulkan::Common::ResourceState> initialState,
+		std::optional<Vulkan::Common::ResourceState> finalState)
+	{
+		Vulkan::Common::ResourceState state = Vulkan::Common::ResourceStates::Undefined;
+		if (initialState)
+		{
+			state = *initialState;
+		}
+		else if (auto it = _importedStates.find(image); it != _importedStates.end())
+		{
+			state = it->second;
+		}
+
+		_resources.push_back(
+			{
+				.Name = name,
+				.Imported = true,
+				.IsBuffer = false,
+				.Image = image,
+				.View = view,
+				.Buffer = VK_NULL_HANDLE,
+				.Desc = {},
+				.BufferDesc = {},
+				.State = state,
+				.FinalState = finalState,
+				.FirstPass = -1,
+				.LastPass = -1,
+				.Transient = -1,
+				.Touched = false,
+			}
+		);
+
+		return (RenderGraphResource)(_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::CreateImage(const std::string& name, const RenderGraphImageDesc& desc)
+	{
+		_resources.push_back(
+			{
+				.Name = name,
+				.Imported = false,
+				.IsBuffer = false,
+				.Image = VK_NULL_HANDLE,
+				.View = VK_NULL_HANDLE,
+				.Buffer = VK_NULL_HANDLE,
+				.Desc = desc,
+				.BufferDesc = {},
+				.State = Vulkan::Common::ResourceStates::Undefined,
+				.FinalState = {},
+				.FirstPass = -1,
+				.LastPass = -1,
+				.Transient = -1,
+				.Touched = false,
+			}
+		);
+
+		return (RenderGraphResource)(_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::ImportBuffer(
+		const std::string& name,
+		VkBuffer buffer,
+		std::optional<Vulkan::Common::ResourceState> initialState,
+		std::optional<Vulkan::Common::ResourceState> finalState)
+	{
+		Vulkan::Common::ResourceState state = Vulkan::Common::ResourceStates::Undefined;
+		if (initialState)
+		{
+			state = *initialState;
+		}
+		else if (auto it = _importedBufferStates.find(buffer); it != _importedBufferStates.end())
+		{
+			state = it->second;
+		}
+
+		_resources.push_back(
+			{
+				.Name = name,
+				.Imported = true,
+				.IsBuffer = true,
+				.Image = VK_NULL_HANDLE,
+				.View = VK_NULL_HANDLE,
+				.Buffer = buffer,
+				.Desc = {},
+				.BufferDesc = {},
+				.State = state,
+				.FinalState = finalState,
+				.FirstPass = -1,
+				.LastPass = -1,
+				.Transient = -1,
+				.Touched = false,
+			}
+		);
+
+		return (RenderGraphResource)(_resources.size() - 1);
+	}
+
+	RenderGraphResource RenderGraph::CreateBuffer(const std::string& name, const RenderGraphBufferDesc& desc)
+	{
+		_resources.push_back(
+			{
+				.Name = name,
+				.Imported = false,
+				.IsBuffer = true,
+				.Image = VK_NULL_HANDLE,
+				.View = VK_NULL_HANDLE,
+				.Buffer = VK_NULL_HANDLE,
+				.Desc = {},
+				.BufferDesc = desc,
+				.State = Vulkan::Common::ResourceStates::Undefined,
+				.FinalState = {},
+				.FirstPass = -1,
+				.LastPass = -1,
+				.Transient = -1,
+				.Touched = false,
+			}
+		);
+
+		return (RenderGraphResource)(_resources.size() - 1);
+	}
+
+	RenderGraph::Pass& RenderGraph::AddPass(const std::string& name)
+	{
+		Pass& pass = _passes.emplace_back();
+		pass._name = name;
+
+		return pass;
+	}
+
+	void RenderGraph::Compile(Vulkan::Common::DeletionQueue& deletionQueue)
+	{
+		MergeAccesses();
+		CullPasses();
+		ComputeLifetimes();
+		RealizeTransients(deletionQueue);
+	}
+
+	void RenderGraph::MergeAccesses()
+	{
+		// A pass that touches a resource several times gets a single transition for it
+		for (auto& pass : _passes)
+		{
+			std::vector<Pass::Access> merged;
+			for (const auto& access : pass._accesses)
+			{
+				auto it = std::find_if(merged.begin(), merged.end(), [&](const Pass::Access& other) { return other.Resource == access.Resource; });
+				if (it == merged.end())
+				{
+					merged.push_back(access);
+					continue;
+				}
+
+				const Resource& resource = _resources[access.Resource];
+				if (!resource.IsBuffer && it->State.Layout != access.State.Layout)
+				{
+					spdlog::error("RenderGraph: el pase '{0}' usa '{1}' con dos layouts distintos", pass._name, resource.Name);
+					throw std::exception("Accesos incompatibles en un pase del RenderGraph");
+				}
+
+				it->State.Stage |= access.State.Stage;
+				it->State.Access |= access.State.Access;
+				it->Write |= access.Write;
+
+				// The contents are only dropped if every access overwrites them
+				it->Discard = it->Discard && access.Discard;
+			}
+
+			pass._accesses = std::move(merged);
+		}
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Walk the passes backwards keeping track of which resources still have a consumer.
+		// Resources leaving the graph (final state) are always consumed.
+		std::vector<bool> needed(_resources.size());
+		for (size_t i = 0; i < _resources.size(); i++)
+		{
+			needed[i] = _resources[i].FinalState.has_value();
+		}
+
+		_stats.Passes = (uint32_t)_passes.size();
+		_stats.CulledPasses = 0;
+
+		for (auto it = _passes.rbegin(); it != _passes.rend(); it++)
+		{
+			Pass& pass = *it;
+
+			bool alive = pass._sideEffect;
+			for (const auto& access : pass._accesses)
+			{
+				alive |= access.Write && needed[access.Resource];
+			}
+
+			pass._culled = !alive;
+			if (!alive)
+			{
+				_stats.CulledPasses++;
+				continue;
+			}
+
+			for (const auto& access : pass._accesses)
+			{
+				if (access.Write && access.Discard)
+				{
+					needed[access.Resource] = false;
+				}
+			}
+
+			// Reads and partial writes depend on whatever was written before
+			for (const auto& access : pass._accesses)
+			{
+				if (!access.Write || !access.Discard)
+				{
+					needed[access.Resource] = true;
+				}
+			}
+		}
+	}
+
+	void RenderGraph::ComputeLifetimes()
+	{
+		int32_t passIndex = 0;
+		for (const auto& pass : _passes)
+		{
+			if (pass._culled)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass._accesses)
+			{
+				Resource& resource = _resources[access.Resource];
+				if (resource.FirstPass < 0)
+				{
+					resource.FirstPass = passIndex;
+				}
+				resource.LastPass = passIndex;
+			}
+
+			passIndex++;
+		}
+	}
+
+	void RenderGraph::RealizeTransients(Vulkan::Common::DeletionQueue& deletionQueue)
+	{
+		std::vector<RenderGraphResource> used;
+		for (RenderGraphResource i = 0; i < (RenderGraphResource)_resources.size(); i++)
+		{
+			if (!_resources[i].Imported && _resources[i].FirstPass >= 0)
+			{
+				used.push_back(i);
+			}
+		}
+
+		bool reuse = used.size() == _transients.size();
+		for (size_t i = 0; reuse && i < used.size(); i++)
+		{
+			const Resource& resource = _resources[used[i]];
+			const TransientResource& transient = _transients[i];
+
+			reuse = resource.IsBuffer == transient.IsBuffer
+				&& resource.Desc == transient.Desc
+				&& resource.BufferDesc == transient.BufferDesc
+				&& resource.FirstPass == transient.FirstPass
+				&& resource.LastPass == transient.LastPass;
+		}
+
+		if (!reuse)
+		{
+			RetireTransients(deletionQueue);
+
+			std::vector<VkMemoryRequirements> requirements(used.size());
+			for (size_t i = 0; i < used.size(); i++)
+			{
+				const Resource& resource = _resources[used[i]];
+
+				TransientResource transient
+				{
+					.IsBuffer = resource.IsBuffer,
+					.Desc = resource.Desc,
+					.BufferDesc = resource.BufferDesc,
+					.FirstPass = resource.FirstPass,
+					.LastPass = resource.LastPass,
+					.Image = VK_NULL_HANDLE,
+					.View = VK_NULL_HANDLE,
+					.Buffer = VK_NULL_HANDLE,
+					.Slot = 0,
+				};
+
+				if (resource.IsBuffer)
+				{
+					VkBufferCreateInfo bufferInfo
+					{
+						.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+						.size = resource.BufferDesc.Size,
+						.usage = resource.BufferDesc.Usage,
+						.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+					};
+
+					VK_CHECK(vkCreateBuffer(_device, &bufferInfo, nullptr, &transient.Buffer));
+					vkGetBufferMemoryRequirements(_device, transient.Buffer, &requirements[i]);
+				}
+				else
+				{
+					VkImageCreateInfo imageInfo = Vulkan::Init::imageCreateInfo(
+						resource.Desc.Format,
+						resource.Desc.Usage,
+						{ resource.Desc.Extent.width, resource.Desc.Extent.height, 1 });
+
+					VK_CHECK(vkCreateImage(_device, &imageInfo, nullptr, &transient.Image));
+					vkGetImageMemoryRequirements(_device, transient.Image, &requirements[i]);
+				}
+
+				_transients.push_back(transient);
+			}
+
+			// Greedy aliasing: resources whose lifetimes do not overlap share the same memory block.
+			// Buffers and images never share one, so bufferImageGranularity does not matter.
+			std::vector<size_t> order(used.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+				{
+					return _transients[a].FirstPass < _transients[b].FirstPass;
+				}
+			);
+
+			_stats.TransientMemoryUnaliased = 0;
+			for (size_t i : order)
+			{
+				TransientResource& transient = _transients[i];
+				const VkMemoryRequirements& req = requirements[i];
+				_stats.TransientMemoryUnaliased += req.size;
+
+				auto slot = std::find_if(_slots.begin(), _slots.end(), [&](const MemorySlot& s)
+					{
+						return s.LastPass < transient.FirstPass
+							&& s.Buffer == transient.IsBuffer
+							&& (s.Requirements.memoryTypeBits & req.memoryTypeBits) != 0;
+					}
+				);
+
+				if (slot == _slots.end())
+				{
+					_slots.push_back(
+						{
+							.Allocation = nullptr,
+							.Requirements = req,
+							.Buffer = transient.IsBuffer,
+							.LastPass = transient.LastPass,
+							.State = Vulkan::Common::ResourceStates::Undefined,
+						}
+					);
+					transient.Slot = (uint32_t)(_slots.size() - 1);
+					continue;
+				}
+
+				slot->Requirements.size = std::max(slot->Requirements.size, req.size);
+				slot->Requirements.alignment = std::max(slot->Requirements.alignment, req.alignment);
+				slot->Requirements.memoryTypeBits &= req.memoryTypeBits;
+				slot->LastPass = transient.LastPass;
+				transient.Slot = (uint32_t)(slot - _slots.begin());
+			}
+
+			VmaAllocationCreateInfo allocInfo
+			{
+				.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+				.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			};
+
+			_stats.TransientMemory = 0;
+			for (auto& slot : _slots)
+			{
+				VK_CHECK(vmaAllocateMemory(_allocator, &slot.Requirements, &allocInfo, &slot.Allocation, nullptr));
+				_stats.TransientMemory += slot.Requirements.size;
+			}
+
+			for (auto& transient : _transients)
+			{
+				if (transient.IsBuffer)
+				{
+					VK_CHECK(vmaBindBufferMemory(_allocator, _slots[transient.Slot].Allocation, transient.Buffer));
+					continue;
+				}
+
+				VK_CHECK(vmaBindImageMemory(_allocator, _slots[transient.Slot].Allocation, transient.Image));
+
+				VkImageViewCreateInfo viewInfo = Vulkan::Init::imageViewCreateInfo(
+					transient.Desc.Format,
+					transient.Image,
+					aspectFromFormat(transient.Desc.Format));
+
+				VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &transient.View));
+			}
+
+			spdlog::debug("RenderGraph: {0} recursos transitorios en {1} bloques ({2} KB, {3} KB sin aliasing)",
+				_transients.size(),
+				_slots.size(),
+				_stats.TransientMemory / 1024,
+				_stats.TransientMemoryUnaliased / 1024);
+		}
+
+		for (size_t i = 0; i < used.size(); i++)
+		{
+			Resource& resource = _resources[used[i]];
+			resource.Transient = (int32_t)i;
+			resource.Image = _transients[i].Image;
+			resource.View = _transients[i].View;
+			resource.Buffer = _transients[i].Buffer;
+		}
+	}
+
+	void RenderGraph::RetireTransients(Vulkan::Common::DeletionQueue& deletionQueue)
+	{
+		if (_transients.empty() && _slots.empty())
+		{
+			return;
+		}
+
+		std::vector<TransientResource> transients = std::move(_transients);
+		std::vector<MemorySlot> slots = std::move(_slots);
+		_transients.clear();
+		_slots.clear();
+
+		VkDevice device = _device;
+		VmaAllocator allocator = _allocator;
+
+		deletionQueue.Push([=]()
+			{
+				for (auto& transient : transients)
+				{
+					vkDestroyImageView(device, transient.View, nullptr);
+					vkDestroyImage(device, transient.Image, nullptr);
+					vkDestroyBuffer(device, transient.Buffer, nullptr);
+				}
+
+				for (auto& slot : slots)
+				{
+					vmaFreeMemory(allocator, slot.Allocation);
+				}
+			}
+		);
+	}
+
+	void RenderGraph::Transition(
+		Vulkan::Common::BarrierBuilder& barriers,
+		Resource& resource,
+		const Vulkan::Common::ResourceState& state,
+		bool discard)
+	{
+		Vulkan::Common::ResourceState from = resource.State;
+
+		// A transient starts every frame without contents, but it has to wait for the last user of its memory
+		MemorySlot* slot = resource.Transient >= 0 ? &_slots[_transients[resource.Transient].Slot] : nullptr;
+		if (slot && !resource.Touched)
+		{
+			from = slot->State;
+			discard = true;
+		}
+		resource.Touched = true;
+
+		// Buffers have no layout and no contents to discard, only the accesses matter
+		bool readAfterRead = !Vulkan::Common::isWriteAccess(from.Access) && !Vulkan::Common::isWriteAccess(state.Access);
+		bool sameLayout = resource.IsBuffer || (!discard && from.Layout == state.Layout);
+		if (readAfterRead && sameLayout)
+		{
+			resource.State.Stage |= state.Stage;
+			resource.State.Access |= state.Access;
+		}
+		else if (resource.IsBuffer)
+		{
+			barriers.Buffer(resource.Buffer, from, state);
+			resource.State = state;
+		}
+		else
+		{
+			barriers.Image(resource.Image, from, state, discard);
+			resource.State = state;
+		}
+
+		if (slot)
+		{
+			slot->State = resource.State;
+		}
+	}
+
+	void RenderGraph::Execute(VkCommandBuffer cmd)
+	{
+		Vulkan::Common::BarrierBuilder barriers;
+
+		_stats.BarrierBatches = 0;
+		_stats.Barriers = 0;
+
+		auto flush = [&]()
+			{
+				if (!barriers.Empty())
+				{
+					_stats.BarrierBatches++;
+					_stats.Barriers += (uint32_t)barriers.Count();
+				}
+				barriers.Flush(cmd);
+			};
+
+		for (auto& pass : _passes)
+		{
+			if (pass._culled)
+			{
+				continue;
+			}
+
+			for (const auto& access : pass._accesses)
+			{
+				Transition(barriers, _resources[access.Resource], access.State, access.Discard);
+			}
+
+			flush();
+
+			if (pass._execute)
+			{
+				pass._execute(cmd);
+			}
+		}
+
+		for (auto& resource : _resources)
+		{
+			if (resource.FinalState)
+			{
+				Transition(barriers, resource, *resource.FinalState, false);
+			}
+		}
+
+		flush();
+
+		for (const auto& resource : _resources)
+		{
+			if (!resource.Imported || !resource.Touched)
+			{
+				continue;
+			}
+
+			if (resource.IsBuffer)
+			{
+				_importedBufferStates[resource.Buffer] = resource.State;
+			}
+			else
+			{
+				_importedStates[resource.Image] = resource.State;
+			}
+		}
+	}
+
+	void RenderGraph::ForgetImage(VkImage image)
+	{
+		_importedStates.erase(image);
+	}
+
+	void RenderGraph::ForgetBuffer(VkBuffer buffer)
+	{
+		_importedBufferStates.erase(buffer);
+	}
+
+	VkImage RenderGraph::GetImage(RenderGraphResource resource) const
+	{
+		return _resources[resource].Image;
+	}
+
+	VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+	{
+		return _resources[resource].View;
+	}
+
+	VkBuffer RenderGraph::GetBuffer(RenderGraphResource resource) const
+	{
+		return _resources[resource].Buffer;
+	}
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+#include "../Vulkan/Common/BarrierBuilder.hpp"
+#include "../Vulkan/Common/DeletionQueue.hpp"
+
+namespace Renderer
+{
+	using RenderGraphResource = uint32_t;
+
+	struct RenderGraphImageDesc
+	{
+		VkFormat Format;
+		VkExtent2D Extent;
+		VkImageUsageFlags Usage;
+
+		inline bool operator==(const RenderGraphImageDesc& other) const
+		{
+			return Format == other.Format
+				&& Extent.width == other.Extent.width
+				&& Extent.height == other.Extent.height
+				&& Usage == other.Usage;
+		}
+	};
+
+	struct RenderGraphBufferDesc
+	{
+		VkDeviceSize Size;
+		VkBufferUsageFlags Usage;
+
+		inline bool operator==(const RenderGraphBufferDesc& other) const
+		{
+			return Size == other.Size && Usage == other.Usage;
+		}
+	};
+
+	class RenderGraph
+	{
+	public:
+		class Pass
+		{
+		public:
+			Pass& Read(RenderGraphResource resource, const Vulkan::Common::ResourceState& state);
+
+			// discard: the pass overwrites the whole resource, previous writers are not needed
+			Pass& Write(RenderGraphResource resource, const Vulkan::Common::ResourceState& state, bool discard = false);
+
+			// The pass is never culled, even if nobody consumes what it writes
+			Pass& SideEffect();
+
+			Pass& Execute(std::function<void(VkCommandBuffer)>&& function);
+
+		private:
+			friend class RenderGraph;
+
+			struct Access
+			{
+				RenderGraphResource Resource;
+				Vulkan::Common::ResourceState State;
+				bool Write;
+				bool Discard;
+			};
+
+			std::string _name;
+			std::vector<Access> _accesses;
+			std::function<void(VkCommandBuffer)> _execute;
+			bool _sideEffect = false;
+			bool _culled = false;
+		};
+
+		struct Stats
+		{
+			uint32_t Passes = 0;
+			uint32_t CulledPasses = 0;
+			uint32_t BarrierBatches = 0;
+			uint32_t Barriers = 0;
+			VkDeviceSize TransientMemory = 0;
+			VkDeviceSize TransientMemoryUnaliased = 0;
+		};
+
+	public:
+		void Init(VkDevice device, VmaAllocator allocator);
+		void Destroy();
+
+		// Clears the passes and resources declared for the previous frame
+		void Reset();
+
+		// initialState: state of the image when the graph starts, if empty the last state recorded by the graph is used
+		// finalState: the image is consumed outside the graph and is left in this state
+		RenderGraphResource ImportImage(
+			const std::string& name,
+			VkImage image,
+			VkImageView view,
+			std::optional<Vulkan::Common::ResourceState> initialState = {},
+			std::optional<Vulkan::Common::ResourceState> finalState = {});
+
+		// Transient images live only inside the graph and may alias memory with other transients
+		RenderGraphResource CreateImage(const std::string& name, const RenderGraphImageDesc& desc);
+
+		// Same as images, the layout of the states is ignored
+		RenderGraphResource ImportBuffer(
+			const std::string& name,
+			VkBuffer buffer,
+			std::optional<Vulkan::Common::ResourceState> initialState = {},
+			std::optional<Vulkan::Common::ResourceState> finalState = {});
+
+		// Transient buffers only alias memory with other transient buffers
+		RenderGraphResource CreateBuffer(const std::string& name, const RenderGraphBufferDesc& desc);
+
+		Pass& AddPass(const std::string& name);
+
+		// Culls unused passes and realizes transient resources, retired ones are pushed to the deletion queue
+		void Compile(Vulkan::Common::DeletionQueue& deletionQueue);
+		void Execute(VkCommandBuffer cmd);
+
+		// Drops the tracked state of an imported image that is about to be destroyed
+		void ForgetImage(VkImage image);
+		void ForgetBuffer(VkBuffer buffer);
+
+		VkImage GetImage(RenderGraphResource resource) const;
+		VkImageView GetImageView(RenderGraphResource resource) const;
+		VkBuffer GetBuffer(RenderGraphResource resource) const;
+
+		inline const Stats& GetStats() const { return _stats; }
+
+	private:
+		struct Resource
+		{
+			std::string Name;
+			bool Imported;
+			bool IsBuffer;
+			VkImage Image;
+			VkImageView View;
+			VkBuffer Buffer;
+			RenderGraphImageDesc Desc;
+			RenderGraphBufferDesc BufferDesc;
+			Vulkan::Common::ResourceState State;
+			std::optional<Vulkan::Common::ResourceState> FinalState;
+			int32_t FirstPass;
+			int32_t LastPass;
+			int32_t Transient;
+			bool Touched;
+		};
+
+		struct TransientResource
+		{
+			bool IsBuffer;
+			RenderGraphImageDesc Desc;
+			RenderGraphBufferDesc BufferDesc;
+			int32_t FirstPass;
+			int32_t LastPass;
+			VkImage Image;
+			VkImageView View;
+			VkBuffer Buffer;
+			uint32_t Slot;
+		};
+
+		struct MemorySlot
+		{
+			VmaAllocation Allocation;
+			VkMemoryRequirements Requirements;
+			bool Buffer;
+			int32_t LastPass;
+			Vulkan::Common::ResourceState State;
+		};
+
+		void MergeAccesses();
+		void CullPasses();
+		void ComputeLifetimes();
+		void RealizeTransients(Vulkan::Common::DeletionQueue& deletionQueue);
+		void RetireTransients(Vulkan::Common::DeletionQueue& deletionQueue);
+
+		void Transition(Vulkan::Common::BarrierBuilder& barriers, Resource& resource, const Vulkan::Common::ResourceState& state, bool discard);
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VmaAllocator _allocator = nullptr;
+
+		std::vector<Resource> _resources;
+		std::deque<Pass> _passes;
+
+		std::vector<TransientResource> _transients;
+		std::vector<MemorySlot> _slots;
+
+		std::unordered_map<VkImage, Vulkan::Common::ResourceState> _importedStates;
+		std::unordered_map<VkBuffer, Vulkan::Common::ResourceState> _importedBufferStates;
+
+		Stats _stats;
+	};
+}
@@ -4,14 +4,19 @@
 #include <memory>
 #include <vulkan/vulkan.h>
 
+#include "ShaderReflection.hpp"
+
 namespace Renderer
 {
 	enum class ShaderType : uint8_t
 	{
 		Vertex = 1,
-		Fragment = 2
+		Fragment = 2,
+		Compute = 4
 	};
 
+	class ShaderFuture;
+
 	class Shader
 	{
 	public:
@@ -23,16 +28,33 @@ namespace Renderer
 			const std::vector<uint32_t>& fragmentCode);
 		virtual ~Shader() = default;
 
-		static std::shared_ptr<Shader> Create(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath);
+		static std::shared_ptr<Shader> Create(
+			const std::string& name,
+			const std::string& vertexPath,
+			const std::string& fragmentPath,
+			const std::vector<std::string>& defines = {});
+		// Blocks until both stages are compiled
+		static std::shared_ptr<Shader> Create(const std::string& name, const ShaderFuture& vertex, const ShaderFuture& fragment);
 
 		VkShaderModule BuildModule(VkDevice device, ShaderType type) const;
 
+		// Both stages merged
+		inline const ShaderReflection& GetReflection() const { return _reflection; }
+		// Identifies the SPIR-V of both stages
+		inline uint64_t GetHash() const { return _hash; }
+		inline uint64_t GetStageHash(ShaderType type) const { return type == ShaderType::Vertex ? _vertexHash : _fragmentHash; }
+		inline const std::vector<uint32_t>& GetCode(ShaderType type) const { return type == ShaderType::Vertex ? _vertexCode : _fragmentCode; }
+
 	private:
 		std::string _name;
 		std::string _vertexPath;
 		std::string _fragmentPath;
 		std::vector<uint32_t> _vertexCode;
 		std::vector<uint32_t> _fragmentCode;
+		ShaderReflection _reflection;
+		uint64_t _hash = 0;
+		uint64_t _vertexHash = 0;
+		uint64_t _fragmentHash = 0;
 	};
 
 	class ComputeShader
@@ -45,13 +67,19 @@ namespace Renderer
 		virtual ~ComputeShader() = default;
 
 		static std::shared_ptr<ComputeShader> Create(const std::string& name, const std::string& path);
+		static std::shared_ptr<ComputeShader> Create(const std::string& name, const ShaderFuture& code);
 
 		VkShaderModule BuildModule(VkDevice device) const;
 
+		inline const ShaderReflection& GetReflection() const { return _reflection; }
+		// Identifies the SPIR-V
+		inline uint64_t GetHash() const { return _hash; }
 
 	private:
 		std::string _name;
 		std::string _path;
 		std::vector<uint32_t> _code;
+		ShaderReflection _reflection;
+		uint64_t _hash = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "ShaderBundle.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "../Common/Hash.hpp"
+#include "../Common/Utils.hpp"
+
+// "VLSB"
+static const uint32_t BUNDLE_MAGIC = 0x42534C56;
+static const uint32_t BUNDLE_VERSION = 1;
+
+struct BundleHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t EntryCount;
+	uint32_t Reserved;
+};
+
+struct BundleEntry
+{
+	uint64_t Key;
+	// In bytes from the start of the file
+	uint32_t Offset;
+	uint32_t WordCount;
+};
+
+namespace Renderer
+{
+	uint64_t ShaderBundle::Key(const std::string& path, ShaderType type, const std::vector<std::string>& defines)
+	{
+		uint64_t hash = Common::Hash::fnv1a(path);
+		hash = Common::Hash::fnv1aValue(type, hash);
+		for (const auto& define : defines)
+		{
+			// The separator keeps {"AB"} and {"A", "B"} apart
+			hash = Common::Hash::fnv1a(define, hash);
+			hash = Common::Hash::fnv1aValue('\0', hash);
+		}
+
+		return hash;
+	}
+
+	bool ShaderBundle::Open(const std::filesystem::path& path)
+	{
+		_entryCount = 0;
+
+		if (!_file.Open(path))
+		{
+			return false;
+		}
+
+		const auto* header = reinterpret_cast<const BundleHeader*>(_file.GetData());
+		if (_file.GetSize() < sizeof(BundleHeader) || header->Magic != BUNDLE_MAGIC || header->Version != BUNDLE_VERSION)
+		{
+			spdlog::error("El paquete de shaders '{0}' no es valido", path.string());
+			_file.Close();
+			return false;
+		}
+
+		// Every entry is checked once here, Find trusts them
+		size_t indexEnd = sizeof(BundleHeader) + sizeof(BundleEntry) * header->EntryCount;
+		if (_file.GetSize() < indexEnd)
+		{
+			spdlog::error("El paquete de shaders '{0}' esta truncado", path.string());
+			_file.Close();
+			return false;
+		}
+
+		const auto* entries = reinterpret_cast<const BundleEntry*>(_file.GetData() + sizeof(BundleHeader));
+		for (uint32_t i = 0; i < header->EntryCount; i++)
+		{
+			uint64_t end = (uint64_t)entries[i].Offset + (uint64_t)entries[i].WordCount * sizeof(uint32_t);
+			if (entries[i].Offset < indexEnd || entries[i].Offset % sizeof(uint32_t) != 0 || end > _file.GetSize())
+			{
+				spdlog::error("El paquete de shaders '{0}' esta truncado", path.string());
+				_file.Close();
+				return false;
+			}
+		}
+
+		_entryCount = header->EntryCount;
+
+		spdlog::info("Paquete de shaders '{0}' abierto con {1} shaders", path.string(), _entryCount);
+
+		return true;
+	}
+
+	std::span<const uint32_t> ShaderBundle::Find(const std::string& path, ShaderType type, const std::vector<std::string>& defines) const
+	{
+		if (_entryCount == 0)
+		{
+			return {};
+		}
+
+		uint64_t key = Key(path, type, defines);
+
+		const auto* begin = reinterpret_cast<const BundleEntry*>(_file.GetData() + sizeof(BundleHeader));
+		const auto* end = begin + _entryCount;
+
+		const auto* entry = std::lower_bound(begin, end, key, [](const BundleEntry& entry, uint64_t key)
+			{
+				return entry.Key < key;
+			}
+		);
+
+		if (entry == end || entry->Key != key)
+		{
+			return {};
+		}
+
+		return std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(_file.GetData() + entry->Offset), entry->WordCount);
+	}
+
+	void ShaderBundleWriter::Add(const std::string& path, ShaderType type, const std::vector<std::string>& defines, const std::vector<uint32_t>& code)
+	{
+		_entries[ShaderBundle::Key(path, type, defines)] = code;
+	}
+
+	bool ShaderBundleWriter::Write(const std::filesystem::path& path) const
+	{
+		BundleHeader header
+		{
+			.Magic = BUNDLE_MAGIC,
+			.Version = BUNDLE_VERSION,
+			.EntryCount = (uint32_t)_entries.size(),
+			.Reserved = 0,
+		};
+
+		std::vector<uint8_t> data(sizeof(BundleHeader) + sizeof(BundleEntry) * _entries.size());
+		memcpy(data.data(), &header, sizeof(BundleHeader));
+
+		// std::map iterates in key order, the index is written sorted for the binary search
+		size_t index = 0;
+		for (const auto& [key, code] : _entries)
+		{
+			BundleEntry entry
+			{
+				.Key = key,
+				.Offset = (uint32_t)data.size(),
+				.WordCount = (uint32_t)code.size(),
+			};
+
+			memcpy(data.data() + sizeof(BundleHeader) + sizeof(BundleEntry) * index++, &entry, sizeof(BundleEntry));
+
+			const auto* bytes = reinterpret_cast<const uint8_t*>(code.data());
+			data.insert(data.end(), bytes, bytes + code.size() * sizeof(uint32_t));
+		}
+
+		return Common::Utils::writeFileAtomic(path, data.data(), data.size());
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "Shader.hpp"
+#include "../Common/MappedFile.hpp"
+
+namespace Renderer
+{
+	// Every cooked SPIR-V stage and variant in one file, mapped at startup instead of compiling.
+	// Layout: header, entries sorted by key, code.
+	class ShaderBundle
+	{
+	public:
+		// Identifies a stage compiled from path with these defines, in this order
+		static uint64_t Key(const std::string& path, ShaderType type, const std::vector<std::string>& defines);
+
+		// False when the file is missing or was not written by ShaderBundleWriter
+		bool Open(const std::filesystem::path& path);
+
+		inline size_t GetEntryCount() const { return _entryCount; }
+
+		// Points into the mapping, empty when the stage was not cooked. Safe from any thread.
+		std::span<const uint32_t> Find(const std::string& path, ShaderType type, const std::vector<std::string>& defines) const;
+
+	private:
+		Common::MappedFile _file;
+		size_t _entryCount = 0;
+	};
+
+	// Used by the cook step
+	class ShaderBundleWriter
+	{
+	public:
+		void Add(const std::string& path, ShaderType type, const std::vector<std::string>& defines, const std::vector<uint32_t>& code);
+
+		bool Write(const std::filesystem::path& path) const;
+
+	private:
+		std::map<uint64_t, std::vector<uint32_t>> _entries;
+	};
+}
@@ -0,0 +1,241 @@
+#include "ShaderCompiler.hpp"
+
+#include <optional>
+#include <filesystem>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#include "ShaderBundle.hpp"
+
+#ifndef VL_USE_SHADER_BUNDLE
+#include <shaderc/shaderc.hpp>
+
+#include "../Common/Utils.hpp"
+#include "../Common/Hash.hpp"
+
+static const char* SHADER_CACHE_DIRECTORY = "cache/shaders";
+
+// Describes the options set by createOptions, part of the cache key. Bump when the options change.
+static const char* SHADER_OPTIONS_KEY = "v1;vulkan1.3;spirv1.3;glsl;performance";
+
+// shaderc has no version query, the libraries in lib come from the Vulkan SDK of the headers in include
+// and VK_HEADER_VERSION_COMPLETE identifies them. Bump when shaderc, glslang or spirv-opt are updated
+// without updating the headers, otherwise SPIR-V built by the old compiler is reused.
+static const char* SHADER_COMPILER_KEY = "shaderc;vulkan-sdk;v1";
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+static shaderc::CompileOptions createOptions()
+{
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+	options.SetSourceLanguage(shaderc_source_language_glsl);
+	options.SetTargetSpirv(shaderc_spirv_version_1_3);
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+	return options;
+}
+
+static std::vector<char> preprocess(const shaderc::Compiler& compiler, const char* code, shaderc_shader_kind kind, const char* path, const shaderc::CompileOptions& options)
+{
+	shaderc::PreprocessedSourceCompilationResult result = compiler.PreprocessGlsl(code, kind, path, options);
+
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		spdlog::error("Error al compilar el shader '{0}' con error: '{1}'", path, result.GetErrorMessage().c_str());
+		throw std::exception(result.GetErrorMessage().c_str());
+	}
+
+	const char* src = result.cbegin();
+	size_t newSize = result.cend() - src;
+	std::vector<char> buffer(newSize + 1);
+	memcpy(buffer.data(), src, newSize);
+	buffer[newSize] = '\0';
+
+	return buffer;
+}
+
+static std::vector<uint32_t> compile(const shaderc::Compiler& compiler, const char* code, shaderc_shader_kind kind, const char* path, const shaderc::CompileOptions& options)
+{
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(code, kind, path, options);
+
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		spdlog::error("Error al compilar el shader '{0}' con error: '{1}'", path, result.GetErrorMessage().c_str());
+		throw std::exception(result.GetErrorMessage().c_str());
+	}
+
+	const uint32_t* src = result.cbegin();
+	size_t newSize = result.cend() - src;
+	std::vector<uint32_t> buffer(newSize);
+	memcpy(buffer.data(), src, newSize * sizeof(uint32_t));
+
+	return buffer;
+}
+
+// Content addressed: the preprocessed source already folds in every include and define
+static uint64_t cacheKey(const std::vector<char>& preprocessed, shaderc_shader_kind kind)
+{
+	uint64_t hash = Common::Hash::fnv1a(preprocessed.data(), preprocessed.size() - 1);
+	hash = Common::Hash::fnv1aValue(kind, hash);
+	hash = Common::Hash::fnv1a(SHADER_OPTIONS_KEY, hash);
+	hash = Common::Hash::fnv1a(SHADER_COMPILER_KEY, hash);
+	hash = Common::Hash::fnv1aValue(VK_HEADER_VERSION_COMPLETE, hash);
+
+	return hash;
+}
+
+static std::optional<std::vector<uint32_t>> loadCached(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return std::nullopt;
+	}
+
+	size_t size = (size_t)file.tellg();
+	if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<uint32_t> code(size / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(code.data()), size);
+
+	if (!file.good() || code[0] != SPIRV_MAGIC)
+	{
+		return std::nullopt;
+	}
+
+	return code;
+}
+
+static std::vector<uint32_t> compileCached(const shaderc::Compiler& compiler, const std::string& path, shaderc_shader_kind kind, const shaderc::CompileOptions& options)
+{
+	auto code = Common::Utils::readFile(path.c_str());
+	auto preprocessed = preprocess(compiler, code.data(), kind, path.c_str(), options);
+
+	std::filesystem::path cachePath = std::filesystem::path(SHADER_CACHE_DIRECTORY) / (Common::Hash::toHex(cacheKey(preprocessed, kind)) + ".spv");
+
+	if (auto cached = loadCached(cachePath))
+	{
+		spdlog::debug("Shader '{0}' cargado desde cache", path);
+		return std::move(*cached);
+	}
+
+	auto compiled = compile(compiler, preprocessed.data(), kind, path.c_str(), options);
+	Common::Utils::writeFileAtomic(cachePath, compiled.data(), compiled.size() * sizeof(uint32_t));
+
+	spdlog::info("Shader '{0}' compilado", path);
+
+	return compiled;
+}
+
+static shaderc_shader_kind shaderKind(Renderer::ShaderType type)
+{
+	switch (type)
+	{
+		case Renderer::ShaderType::Vertex:
+			return shaderc_glsl_vertex_shader;
+
+		case Renderer::ShaderType::Fragment:
+			return shaderc_glsl_fragment_shader;
+
+		case Renderer::ShaderType::Compute:
+			return shaderc_glsl_compute_shader;
+	}
+
+	throw std::exception("Tipo de shader desconocido");
+}
+#endif
+
+namespace Renderer
+{
+	ShaderFuture::ShaderFuture(const std::string& path, Common::JobSystem* jobs, const Common::JobCounterPtr& counter, std::shared_future<ShaderCode>&& code) :
+		_path(path),
+		_jobs(jobs),
+		_counter(counter),
+		_code(std::move(code))
+	{
+	}
+
+	bool ShaderFuture::IsReady() const
+	{
+		return _counter->IsDone();
+	}
+
+	const ShaderCode& ShaderFuture::Get() const
+	{
+		_jobs->Wait(_counter);
+		return _code.get();
+	}
+
+	void ShaderCompiler::Init(Common::JobSystem& jobs, const ShaderBundle* bundle)
+	{
+		_jobs = &jobs;
+		_bundle = bundle;
+	}
+
+	ShaderFuture ShaderCompiler::Compile(const std::string& path, ShaderType type, const std::vector<std::string>& defines)
+	{
+		auto promise = std::make_shared<std::promise<ShaderCode>>();
+		auto counter = _jobs->CreateCounter();
+
+		// Copied straight out of the mapping, the future is ready before it is returned
+		if (_bundle != nullptr)
+		{
+			auto cooked = _bundle->Find(path, type, defines);
+			if (!cooked.empty())
+			{
+				promise->set_value(ShaderCode(cooked.begin(), cooked.end()));
+				return ShaderFuture(path, _jobs, counter, promise->get_future().share());
+			}
+
+			spdlog::warn("El shader '{0}' no esta en el paquete de shaders", path);
+		}
+
+		_jobs->Schedule([promise, path, type, defines]()
+			{
+				try
+				{
+					promise->set_value(CompileNow(path, type, defines));
+				}
+				catch (...)
+				{
+					promise->set_exception(std::current_exception());
+				}
+			},
+			Common::JobLane::Background,
+			counter
+		);
+
+		return ShaderFuture(path, _jobs, counter, promise->get_future().share());
+	}
+
+	ShaderCode ShaderCompiler::CompileNow(const std::string& path, ShaderType type, const std::vector<std::string>& defines)
+	{
+#ifdef VL_USE_SHADER_BUNDLE
+		spdlog::error("El shader '{0}' no esta cocinado y shaderc no esta disponible", path);
+		throw std::exception("Compilacion de shaders no disponible con VL_USE_SHADER_BUNDLE");
+#else
+		// shaderc::Compiler is not safe to share between threads
+		static thread_local shaderc::Compiler compiler;
+		static thread_local shaderc::CompileOptions options = createOptions();
+
+		if (defines.empty())
+		{
+			return compileCached(compiler, path, shaderKind(type), options);
+		}
+
+		shaderc::CompileOptions variantOptions(options);
+		for (const auto& define : defines)
+		{
+			variantOptions.AddMacroDefinition(define);
+		}
+
+		return compileCached(compiler, path, shaderKind(type), variantOptions);
+#endif
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <future>
+
+#include "Shader.hpp"
+#include "../Common/JobSystem.hpp"
+
+namespace Renderer
+{
+	using ShaderCode = std::vector<uint32_t>;
+
+	class ShaderBundle;
+
+	// Pending result of ShaderCompiler::Compile, copies share the same compilation
+	class ShaderFuture
+	{
+	public:
+		ShaderFuture() = default;
+		ShaderFuture(const std::string& path, Common::JobSystem* jobs, const Common::JobCounterPtr& counter, std::shared_future<ShaderCode>&& code);
+
+		bool IsReady() const;
+
+		// Runs other worker jobs while waiting, rethrows the compilation error
+		const ShaderCode& Get() const;
+
+		inline const std::string& GetPath() const { return _path; }
+
+	private:
+		std::string _path;
+		Common::JobSystem* _jobs = nullptr;
+		Common::JobCounterPtr _counter;
+		std::shared_future<ShaderCode> _code;
+	};
+
+	// Compiles GLSL to SPIR-V on the job system workers, every thread keeps its own shaderc::Compiler.
+	// Results go through the on-disk SPIR-V cache.
+	// With VL_USE_SHADER_BUNDLE shaderc is compiled out and every stage must come from the bundle.
+	class ShaderCompiler
+	{
+	public:
+		// bundle: looked up before compiling, must outlive the compiler
+		void Init(Common::JobSystem& jobs, const ShaderBundle* bundle = nullptr);
+
+		// defines: passed as #define NAME before the source, each set is a different cache entry
+		ShaderFuture Compile(const std::string& path, ShaderType type, const std::vector<std::string>& defines = {});
+
+		// Compiles on the calling thread
+		static ShaderCode CompileNow(const std::string& path, ShaderType type, const std::vector<std::string>& defines = {});
+
+	private:
+		Common::JobSystem* _jobs = nullptr;
+		const ShaderBundle* _bundle = nullptr;
+	};
+}
@@ -0,0 +1,243 @@
+#include "ShaderObjectBackend.hpp"
+
+#include <vector>
+#include <type_traits>
+
+#include <spdlog/spdlog.h>
+
+#include "../Vulkan/Types.hpp"
+
+namespace Renderer
+{
+	DynamicGraphicsState& DynamicGraphicsState::SetInputTopology(VkPrimitiveTopology topology)
+	{
+		_topology = topology;
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::SetPolygonMode(VkPolygonMode mode)
+	{
+		_polygonMode = mode;
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::SetCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace)
+	{
+		_cullMode = cullMode;
+		_frontFace = frontFace;
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::SetMultisamplingNone()
+	{
+		_samples = VK_SAMPLE_COUNT_1_BIT;
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::DisableBlending()
+	{
+		_blendEnable = VK_FALSE;
+		_blendEquation = {};
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::EnableBlendingAlphablend()
+	{
+		_blendEnable = VK_TRUE;
+		_blendEquation =
+		{
+			.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+			.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+			.colorBlendOp = VK_BLEND_OP_ADD,
+			.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+			.alphaBlendOp = VK_BLEND_OP_ADD,
+		};
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::EnableDepthtest(bool depthWriteEnable, VkCompareOp op)
+	{
+		_depthTestEnable = VK_TRUE;
+		_depthWriteEnable = depthWriteEnable;
+		_depthCompareOp = op;
+
+		return *this;
+	}
+
+	DynamicGraphicsState& DynamicGraphicsState::DisableDepthTesting()
+	{
+		_depthTestEnable = VK_FALSE;
+		_depthWriteEnable = VK_FALSE;
+		_depthCompareOp = VK_COMPARE_OP_NEVER;
+
+		return *this;
+	}
+
+	bool ShaderObjectBackend::Init(VkDevice device, bool enabled)
+	{
+		_device = VK_NULL_HANDLE;
+
+		if (!enabled)
+		{
+			return false;
+		}
+
+		auto load = [device](auto& function, const char* name)
+		{
+			function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(vkGetDeviceProcAddr(device, name));
+			return function != nullptr;
+		};
+
+		bool loaded = load(_createShaders, "vkCreateShadersEXT")
+			&& load(_destroyShader, "vkDestroyShaderEXT")
+			&& load(_cmdBindShaders, "vkCmdBindShadersEXT")
+			&& load(_cmdSetVertexInput, "vkCmdSetVertexInputEXT")
+			&& load(_cmdSetPolygonMode, "vkCmdSetPolygonModeEXT")
+			&& load(_cmdSetRasterizationSamples, "vkCmdSetRasterizationSamplesEXT")
+			&& load(_cmdSetSampleMask, "vkCmdSetSampleMaskEXT")
+			&& load(_cmdSetAlphaToCoverageEnable, "vkCmdSetAlphaToCoverageEnableEXT")
+			&& load(_cmdSetColorBlendEnable, "vkCmdSetColorBlendEnableEXT")
+			&& load(_cmdSetColorBlendEquation, "vkCmdSetColorBlendEquationEXT")
+			&& load(_cmdSetColorWriteMask, "vkCmdSetColorWriteMaskEXT");
+
+		if (!loaded)
+		{
+			spdlog::warn("VK_EXT_shader_object esta habilitado pero faltan sus funciones");
+			return false;
+		}
+
+		_device = device;
+
+		return true;
+	}
+
+	ShaderObject ShaderObjectBackend::Create(const Shader& shader, LayoutCache& layouts) const
+	{
+		const auto& reflection = shader.GetReflection();
+
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		for (uint32_t set = 0; set < reflection.GetSetCount(); set++)
+		{
+			setLayouts.push_back(layouts.GetSetLayout(reflection, set));
+		}
+
+		VkPushConstantRange pushConstant
+		{
+			.stageFlags = reflection.PushConstantStages,
+			.offset = 0,
+			.size = reflection.PushConstantSize,
+		};
+
+		auto createInfo = [&](ShaderType type, VkShaderStageFlagBits stage, VkShaderStageFlags nextStage)
+		{
+			const auto& code = shader.GetCode(type);
+
+			return VkShaderCreateInfoEXT
+			{
+				.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+				.flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT,
+				.stage = stage,
+				.nextStage = nextStage,
+				.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+				.codeSize = code.size() * sizeof(uint32_t),
+				.pCode = code.data(),
+				.pName = "main",
+				.setLayoutCount = (uint32_t)setLayouts.size(),
+				.pSetLayouts = setLayouts.data(),
+				.pushConstantRangeCount = reflection.PushConstantSize > 0 ? 1u : 0u,
+				.pPushConstantRanges = &pushConstant,
+			};
+		};
+
+		VkShaderCreateInfoEXT createInfos[] =
+		{
+			createInfo(ShaderType::Vertex, VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT),
+			createInfo(ShaderType::Fragment, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+		};
+
+		VkShaderEXT shaders[2] = {};
+		VK_CHECK(_createShaders(_device, 2, createInfos, nullptr, shaders));
+
+		return ShaderObject
+		{
+			.Vertex = shaders[0],
+			.Fragment = shaders[1],
+		};
+	}
+
+	void ShaderObjectBackend::Destroy(const ShaderObject& shaders) const
+	{
+		if (shaders.Vertex != VK_NULL_HANDLE)
+		{
+			_destroyShader(_device, shaders.Vertex, nullptr);
+		}
+		if (shaders.Fragment != VK_NULL_HANDLE)
+		{
+			_destroyShader(_device, shaders.Fragment, nullptr);
+		}
+	}
+
+	void ShaderObjectBackend::Bind(VkCommandBuffer commandBuffer, const ShaderObject& shaders) const
+	{
+		VkShaderStageFlagBits stages[] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+		VkShaderEXT handles[] = { shaders.Vertex, shaders.Fragment };
+
+		_cmdBindShaders(commandBuffer, 2, stages, handles);
+	}
+
+	void ShaderObjectBackend::SetState(VkCommandBuffer commandBuffer, const DynamicGraphicsState& state, VkExtent2D extent) const
+	{
+		VkViewport viewport
+		{
+			.x = 0,
+			.y = 0,
+			.width = float(extent.width),
+			.height = float(extent.height),
+			.minDepth = 0.f,
+			.maxDepth = 1.f,
+		};
+		VkRect2D scissor
+		{
+			.offset = { 0, 0 },
+			.extent = extent,
+		};
+
+		vkCmdSetViewportWithCount(commandBuffer, 1, &viewport);
+		vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+
+		// Vertices are pulled through buffer device addresses, there are no vertex buffers
+		_cmdSetVertexInput(commandBuffer, 0, nullptr, 0, nullptr);
+		vkCmdSetPrimitiveTopology(commandBuffer, state._topology);
+		vkCmdSetPrimitiveRestartEnable(commandBuffer, VK_FALSE);
+
+		vkCmdSetRasterizerDiscardEnable(commandBuffer, VK_FALSE);
+		_cmdSetPolygonMode(commandBuffer, state._polygonMode);
+		vkCmdSetLineWidth(commandBuffer, 1.f);
+		vkCmdSetCullMode(commandBuffer, state._cullMode);
+		vkCmdSetFrontFace(commandBuffer, state._frontFace);
+		vkCmdSetDepthBiasEnable(commandBuffer, VK_FALSE);
+
+		VkSampleMask sampleMask = ~0u;
+		_cmdSetRasterizationSamples(commandBuffer, state._samples);
+		_cmdSetSampleMask(commandBuffer, state._samples, &sampleMask);
+		_cmdSetAlphaToCoverageEnable(commandBuffer, VK_FALSE);
+
+		vkCmdSetDepthTestEnable(commandBuffer, state._depthTestEnable);
+		vkCmdSetDepthWriteEnable(commandBuffer, state._depthWriteEnable);
+		vkCmdSetDepthCompareOp(commandBuffer, state._depthCompareOp);
+		vkCmdSetDepthBoundsTestEnable(commandBuffer, VK_FALSE);
+		vkCmdSetStencilTestEnable(commandBuffer, VK_FALSE);
+
+		VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		_cmdSetColorBlendEnable(commandBuffer, 0, 1, &state._blendEnable);
+		_cmdSetColorBlendEquation(commandBuffer, 0, 1, &state._blendEquation);
+		_cmdSetColorWriteMask(commandBuffer, 0, 1, &writeMask);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include "Shader.hpp"
+#include "LayoutCache.hpp"
+
+namespace Renderer
+{
+	// Rasterization, blend and depth state of a draw, recorded as commands instead of baked into a pipeline.
+	// The setters match GraphicsPipelineBuilder, so the same calls describe both backends.
+	class DynamicGraphicsState
+	{
+	public:
+		DynamicGraphicsState& SetInputTopology(VkPrimitiveTopology topology);
+		DynamicGraphicsState& SetPolygonMode(VkPolygonMode mode);
+		DynamicGraphicsState& SetCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace);
+		DynamicGraphicsState& SetMultisamplingNone();
+		DynamicGraphicsState& DisableBlending();
+		DynamicGraphicsState& EnableBlendingAlphablend();
+		DynamicGraphicsState& EnableDepthtest(bool depthWriteEnable, VkCompareOp op);
+		DynamicGraphicsState& DisableDepthTesting();
+
+	private:
+		friend class ShaderObjectBackend;
+
+		VkPrimitiveTopology _topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkPolygonMode _polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags _cullMode = VK_CULL_MODE_NONE;
+		VkFrontFace _frontFace = VK_FRONT_FACE_CLOCKWISE;
+		VkSampleCountFlagBits _samples = VK_SAMPLE_COUNT_1_BIT;
+		VkBool32 _blendEnable = VK_FALSE;
+		VkColorBlendEquationEXT _blendEquation = {};
+		VkBool32 _depthTestEnable = VK_FALSE;
+		VkBool32 _depthWriteEnable = VK_FALSE;
+		VkCompareOp _depthCompareOp = VK_COMPARE_OP_NEVER;
+	};
+
+	// Linked vertex and fragment stages
+	struct ShaderObject
+	{
+		VkShaderEXT Vertex = VK_NULL_HANDLE;
+		VkShaderEXT Fragment = VK_NULL_HANDLE;
+	};
+
+	// VK_EXT_shader_object: draws bind shaders and set every piece of state themselves, nothing is compiled
+	// per state combination. Only usable when the device enabled the extension.
+	class ShaderObjectBackend
+	{
+	public:
+		// Loads the entry points, false leaves the backend unavailable
+		bool Init(VkDevice device, bool enabled);
+
+		inline bool IsAvailable() const { return _device != VK_NULL_HANDLE; }
+
+		// Safe from any thread. The set layouts and push constants match LayoutCache::GetPipelineLayout,
+		// so descriptor sets and push constants are written with that layout.
+		ShaderObject Create(const Shader& shader, LayoutCache& layouts) const;
+		void Destroy(const ShaderObject& shaders) const;
+
+		void Bind(VkCommandBuffer commandBuffer, const ShaderObject& shaders) const;
+
+		// Everything a pipeline would have baked, the viewport and scissor included
+		void SetState(VkCommandBuffer commandBuffer, const DynamicGraphicsState& state, VkExtent2D extent) const;
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+
+		PFN_vkCreateShadersEXT _createShaders = nullptr;
+		PFN_vkDestroyShaderEXT _destroyShader = nullptr;
+		PFN_vkCmdBindShadersEXT _cmdBindShaders = nullptr;
+		PFN_vkCmdSetVertexInputEXT _cmdSetVertexInput = nullptr;
+		PFN_vkCmdSetPolygonModeEXT _cmdSetPolygonMode = nullptr;
+		PFN_vkCmdSetRasterizationSamplesEXT _cmdSetRasterizationSamples = nullptr;
+		PFN_vkCmdSetSampleMaskEXT _cmdSetSampleMask = nullptr;
+		PFN_vkCmdSetAlphaToCoverageEnableEXT _cmdSetAlphaToCoverageEnable = nullptr;
+		PFN_vkCmdSetColorBlendEnableEXT _cmdSetColorBlendEnable = nullptr;
+		PFN_vkCmdSetColorBlendEquationEXT _cmdSetColorBlendEquation = nullptr;
+		PFN_vkCmdSetColorWriteMaskEXT _cmdSetColorWriteMask = nullptr;
+	};
+}
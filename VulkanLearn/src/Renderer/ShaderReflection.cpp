@@ -0,0 +1,435 @@
+#include "ShaderReflection.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+
+// The subset of the SPIR-V specification needed to find the resource interface
+namespace SpirV
+{
+	static const uint32_t MAGIC = 0x07230203;
+	static const uint32_t HEADER_WORDS = 5;
+
+	static const uint32_t OP_ENTRY_POINT = 15;
+	static const uint32_t OP_EXECUTION_MODE = 16;
+	static const uint32_t OP_TYPE_BOOL = 20;
+	static const uint32_t OP_TYPE_INT = 21;
+	static const uint32_t OP_TYPE_FLOAT = 22;
+	static const uint32_t OP_TYPE_VECTOR = 23;
+	static const uint32_t OP_TYPE_MATRIX = 24;
+	static const uint32_t OP_TYPE_IMAGE = 25;
+	static const uint32_t OP_TYPE_SAMPLER = 26;
+	static const uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+	static const uint32_t OP_TYPE_ARRAY = 28;
+	static const uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+	static const uint32_t OP_TYPE_STRUCT = 30;
+	static const uint32_t OP_TYPE_POINTER = 32;
+	static const uint32_t OP_CONSTANT = 43;
+	static const uint32_t OP_SPEC_CONSTANT = 50;
+	static const uint32_t OP_SPEC_CONSTANT_COMPOSITE = 51;
+	static const uint32_t OP_VARIABLE = 59;
+	static const uint32_t OP_DECORATE = 71;
+	static const uint32_t OP_MEMBER_DECORATE = 72;
+	static const uint32_t OP_EXECUTION_MODE_ID = 331;
+	static const uint32_t OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+	static const uint32_t DECORATION_SPEC_ID = 1;
+	static const uint32_t DECORATION_BUFFER_BLOCK = 3;
+	static const uint32_t DECORATION_ARRAY_STRIDE = 6;
+	static const uint32_t DECORATION_MATRIX_STRIDE = 7;
+	static const uint32_t DECORATION_BUILT_IN = 11;
+	static const uint32_t DECORATION_BINDING = 33;
+	static const uint32_t DECORATION_DESCRIPTOR_SET = 34;
+	static const uint32_t DECORATION_OFFSET = 35;
+
+	static const uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+	static const uint32_t STORAGE_UNIFORM = 2;
+	static const uint32_t STORAGE_PUSH_CONSTANT = 9;
+	static const uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+	static const uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+	static const uint32_t EXECUTION_MODE_LOCAL_SIZE_ID = 38;
+
+	static const uint32_t BUILT_IN_WORKGROUP_SIZE = 25;
+
+	static const uint32_t DIM_BUFFER = 5;
+	static const uint32_t DIM_SUBPASS_DATA = 6;
+
+	static const uint32_t NONE = UINT32_MAX;
+
+	struct Id
+	{
+		uint32_t Opcode = 0;
+		// Words after the result id
+		std::vector<uint32_t> Operands;
+
+		uint32_t Set = NONE;
+		uint32_t Binding = NONE;
+		uint32_t SpecId = NONE;
+		uint32_t BuiltIn = NONE;
+		bool BufferBlock = false;
+		uint32_t ArrayStride = 0;
+
+		std::vector<uint32_t> MemberOffsets;
+		std::vector<uint32_t> MemberMatrixStrides;
+	};
+
+	static VkShaderStageFlags stageFromExecutionModel(uint32_t model)
+	{
+		switch (model)
+		{
+			case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		return 0;
+	}
+
+	static void setMember(std::vector<uint32_t>& members, uint32_t member, uint32_t value)
+	{
+		if (members.size() <= member)
+		{
+			members.resize(member + 1, 0);
+		}
+		members[member] = value;
+	}
+
+	static uint32_t typeSize(const std::vector<Id>& ids, uint32_t typeId, uint32_t matrixStride = 0)
+	{
+		const Id& type = ids[typeId];
+
+		switch (type.Opcode)
+		{
+			case OP_TYPE_BOOL:
+				return 4;
+
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT:
+				return type.Operands[0] / 8;
+
+			case OP_TYPE_VECTOR:
+				return typeSize(ids, type.Operands[0]) * type.Operands[1];
+
+			case OP_TYPE_MATRIX:
+				return (matrixStride != 0 ? matrixStride : typeSize(ids, type.Operands[0])) * type.Operands[1];
+
+			case OP_TYPE_ARRAY:
+			{
+				uint32_t length = ids[type.Operands[1]].Operands[1];
+				uint32_t stride = type.ArrayStride != 0 ? type.ArrayStride : typeSize(ids, type.Operands[0], matrixStride);
+				return stride * length;
+			}
+
+			case OP_TYPE_STRUCT:
+			{
+				uint32_t size = 0;
+				for (size_t i = 0; i < type.Operands.size() && i < type.MemberOffsets.size(); i++)
+				{
+					uint32_t stride = i < type.MemberMatrixStrides.size() ? type.MemberMatrixStrides[i] : 0;
+					size = std::max(size, type.MemberOffsets[i] + typeSize(ids, type.Operands[i], stride));
+				}
+				return size;
+			}
+
+			// Buffer device addresses
+			case OP_TYPE_POINTER:
+				return 8;
+		}
+
+		return 0;
+	}
+
+	static VkDescriptorType descriptorType(const std::vector<Id>& ids, const Id& type, uint32_t storageClass)
+	{
+		switch (type.Opcode)
+		{
+			case OP_TYPE_SAMPLER:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+			case OP_TYPE_SAMPLED_IMAGE:
+			{
+				const Id& image = ids[type.Operands[0]];
+				return image.Operands[1] == DIM_BUFFER ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+
+			case OP_TYPE_IMAGE:
+			{
+				uint32_t dim = type.Operands[1];
+				bool storage = type.Operands[5] == 2;
+
+				if (dim == DIM_BUFFER)
+				{
+					return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				if (dim == DIM_SUBPASS_DATA)
+				{
+					return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			}
+
+			case OP_TYPE_STRUCT:
+				return storageClass == STORAGE_STORAGE_BUFFER || type.BufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+			case OP_TYPE_ACCELERATION_STRUCTURE:
+				return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+		}
+
+		throw std::exception("Tipo de recurso SPIR-V no soportado");
+	}
+}
+
+namespace Renderer
+{
+	ShaderReflection ShaderReflection::Reflect(const std::vector<uint32_t>& code)
+	{
+		if (code.size() < SpirV::HEADER_WORDS || code[0] != SpirV::MAGIC)
+		{
+			throw std::exception("Codigo SPIR-V invalido");
+		}
+
+		ShaderReflection reflection;
+
+		std::vector<SpirV::Id> ids(code[3]);
+		std::vector<uint32_t> variables;
+		std::array<uint32_t, 3> workgroupSizeIds = { SpirV::NONE, SpirV::NONE, SpirV::NONE };
+
+		for (size_t offset = SpirV::HEADER_WORDS; offset < code.size();)
+		{
+			uint32_t opcode = code[offset] & 0xFFFF;
+			uint32_t wordCount = code[offset] >> 16;
+
+			if (wordCount == 0 || offset + wordCount > code.size())
+			{
+				throw std::exception("Codigo SPIR-V truncado");
+			}
+
+			const uint32_t* words = &code[offset];
+			offset += wordCount;
+
+			switch (opcode)
+			{
+				case SpirV::OP_ENTRY_POINT:
+					// Only the first entry point, glslang emits one per module
+					if (reflection.Stages == 0)
+					{
+						reflection.Stages = SpirV::stageFromExecutionModel(words[1]);
+					}
+					break;
+
+				case SpirV::OP_EXECUTION_MODE:
+					if (words[2] == SpirV::EXECUTION_MODE_LOCAL_SIZE && wordCount >= 6)
+					{
+						reflection.WorkgroupSize = { words[3], words[4], words[5] };
+					}
+					break;
+
+				case SpirV::OP_EXECUTION_MODE_ID:
+					if (words[2] == SpirV::EXECUTION_MODE_LOCAL_SIZE_ID && wordCount >= 6)
+					{
+						workgroupSizeIds = { words[3], words[4], words[5] };
+					}
+					break;
+
+				case SpirV::OP_DECORATE:
+				{
+					SpirV::Id& target = ids[words[1]];
+					switch (words[2])
+					{
+						case SpirV::DECORATION_BUFFER_BLOCK: target.BufferBlock = true; break;
+						case SpirV::DECORATION_ARRAY_STRIDE: target.ArrayStride = words[3]; break;
+						case SpirV::DECORATION_BINDING: target.Binding = words[3]; break;
+						case SpirV::DECORATION_DESCRIPTOR_SET: target.Set = words[3]; break;
+						case SpirV::DECORATION_SPEC_ID: target.SpecId = words[3]; break;
+						case SpirV::DECORATION_BUILT_IN: target.BuiltIn = words[3]; break;
+					}
+					break;
+				}
+
+				case SpirV::OP_MEMBER_DECORATE:
+				{
+					SpirV::Id& target = ids[words[1]];
+					switch (words[3])
+					{
+						case SpirV::DECORATION_OFFSET: SpirV::setMember(target.MemberOffsets, words[2], words[4]); break;
+						case SpirV::DECORATION_MATRIX_STRIDE: SpirV::setMember(target.MemberMatrixStrides, words[2], words[4]); break;
+					}
+					break;
+				}
+
+				case SpirV::OP_TYPE_BOOL:
+				case SpirV::OP_TYPE_INT:
+				case SpirV::OP_TYPE_FLOAT:
+				case SpirV::OP_TYPE_VECTOR:
+				case SpirV::OP_TYPE_MATRIX:
+				case SpirV::OP_TYPE_IMAGE:
+				case SpirV::OP_TYPE_SAMPLER:
+				case SpirV::OP_TYPE_SAMPLED_IMAGE:
+				case SpirV::OP_TYPE_ARRAY:
+				case SpirV::OP_TYPE_RUNTIME_ARRAY:
+				case SpirV::OP_TYPE_STRUCT:
+				case SpirV::OP_TYPE_POINTER:
+				case SpirV::OP_TYPE_ACCELERATION_STRUCTURE:
+					ids[words[1]].Opcode = opcode;
+					ids[words[1]].Operands.assign(words + 2, words + wordCount);
+					break;
+
+				// Operands keep the result type first, the value is Operands[1]
+				case SpirV::OP_CONSTANT:
+				case SpirV::OP_SPEC_CONSTANT:
+					ids[words[2]].Opcode = opcode;
+					ids[words[2]].Operands = { words[1], wordCount > 3 ? words[3] : 0 };
+					break;
+
+				case SpirV::OP_SPEC_CONSTANT_COMPOSITE:
+					ids[words[2]].Opcode = opcode;
+					ids[words[2]].Operands.assign(words + 3, words + wordCount);
+					break;
+
+				case SpirV::OP_VARIABLE:
+					ids[words[2]].Opcode = opcode;
+					ids[words[2]].Operands = { words[1], words[3] };
+					variables.push_back(words[2]);
+					break;
+			}
+		}
+
+		for (size_t i = 0; i < workgroupSizeIds.size(); i++)
+		{
+			if (workgroupSizeIds[i] != SpirV::NONE)
+			{
+				reflection.WorkgroupSize[i] = ids[workgroupSizeIds[i]].Operands[1];
+				reflection.WorkgroupSizeSpecIds[i] = ids[workgroupSizeIds[i]].SpecId;
+			}
+		}
+
+		// local_size_x_id and friends: the WorkgroupSize built-in wins over the execution mode
+		for (const auto& id : ids)
+		{
+			if (id.BuiltIn != SpirV::BUILT_IN_WORKGROUP_SIZE || id.Opcode != SpirV::OP_SPEC_CONSTANT_COMPOSITE)
+			{
+				continue;
+			}
+
+			for (size_t i = 0; i < id.Operands.size() && i < reflection.WorkgroupSize.size(); i++)
+			{
+				const SpirV::Id& component = ids[id.Operands[i]];
+				reflection.WorkgroupSize[i] = component.Operands[1];
+				reflection.WorkgroupSizeSpecIds[i] = component.SpecId;
+			}
+		}
+
+		for (uint32_t variableId : variables)
+		{
+			const SpirV::Id& variable = ids[variableId];
+			uint32_t storageClass = variable.Operands[1];
+			const SpirV::Id& pointer = ids[variable.Operands[0]];
+			uint32_t typeId = pointer.Operands[1];
+
+			if (storageClass == SpirV::STORAGE_PUSH_CONSTANT)
+			{
+				reflection.PushConstantSize = std::max(reflection.PushConstantSize, SpirV::typeSize(ids, typeId));
+				reflection.PushConstantStages = reflection.Stages;
+				continue;
+			}
+
+			if (storageClass != SpirV::STORAGE_UNIFORM_CONSTANT
+				&& storageClass != SpirV::STORAGE_UNIFORM
+				&& storageClass != SpirV::STORAGE_STORAGE_BUFFER)
+			{
+				continue;
+			}
+
+			if (variable.Set == SpirV::NONE || variable.Binding == SpirV::NONE)
+			{
+				continue;
+			}
+
+			// Runtime arrays are sized by whoever builds the layout, reflected as a single descriptor
+			uint32_t count = 1;
+			while (ids[typeId].Opcode == SpirV::OP_TYPE_ARRAY || ids[typeId].Opcode == SpirV::OP_TYPE_RUNTIME_ARRAY)
+			{
+				if (ids[typeId].Opcode == SpirV::OP_TYPE_ARRAY)
+				{
+					count *= ids[ids[typeId].Operands[1]].Operands[1];
+				}
+				typeId = ids[typeId].Operands[0];
+			}
+
+			reflection.Bindings.push_back(
+				ReflectedBinding
+				{
+					.Set = variable.Set,
+					.Binding = variable.Binding,
+					.Type = SpirV::descriptorType(ids, ids[typeId], storageClass),
+					.Count = count,
+					.Stages = reflection.Stages,
+				}
+			);
+		}
+
+		// Push constant ranges are declared in multiples of four bytes
+		reflection.PushConstantSize = (reflection.PushConstantSize + 3) & ~3u;
+
+		std::sort(reflection.Bindings.begin(), reflection.Bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+			{
+				return a.Set != b.Set ? a.Set < b.Set : a.Binding < b.Binding;
+			}
+		);
+
+		return reflection;
+	}
+
+	void ShaderReflection::Merge(const ShaderReflection& other)
+	{
+		Stages |= other.Stages;
+
+		for (const auto& binding : other.Bindings)
+		{
+			auto it = std::find_if(Bindings.begin(), Bindings.end(), [&](const ReflectedBinding& existing)
+				{
+					return existing.Set == binding.Set && existing.Binding == binding.Binding;
+				}
+			);
+
+			if (it == Bindings.end())
+			{
+				Bindings.push_back(binding);
+				continue;
+			}
+
+			if (it->Type != binding.Type || it->Count != binding.Count)
+			{
+				spdlog::error("El binding {0} del set {1} difiere entre etapas", binding.Binding, binding.Set);
+				throw std::exception("Bindings incompatibles entre etapas del shader");
+			}
+
+			it->Stages |= binding.Stages;
+		}
+
+		std::sort(Bindings.begin(), Bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+			{
+				return a.Set != b.Set ? a.Set < b.Set : a.Binding < b.Binding;
+			}
+		);
+
+		PushConstantSize = std::max(PushConstantSize, other.PushConstantSize);
+		PushConstantStages |= other.PushConstantStages;
+
+		if (other.Stages & VK_SHADER_STAGE_COMPUTE_BIT)
+		{
+			WorkgroupSize = other.WorkgroupSize;
+			WorkgroupSizeSpecIds = other.WorkgroupSizeSpecIds;
+		}
+	}
+
+	uint32_t ShaderReflection::GetSetCount() const
+	{
+		return Bindings.empty() ? 0 : Bindings.back().Set + 1;
+	}
+}
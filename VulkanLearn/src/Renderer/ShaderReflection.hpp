@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace Renderer
+{
+	struct ReflectedBinding
+	{
+		uint32_t Set;
+		uint32_t Binding;
+		VkDescriptorType Type;
+		uint32_t Count;
+		VkShaderStageFlags Stages;
+	};
+
+	// Resource interface of one or more stages, read straight from the SPIR-V
+	struct ShaderReflection
+	{
+		VkShaderStageFlags Stages = 0;
+
+		// Sorted by set and binding
+		std::vector<ReflectedBinding> Bindings;
+
+		// A single range from offset 0 shared by every stage that declares the block.
+		// vkCmdPushConstants has to be called with all of PushConstantStages.
+		uint32_t PushConstantSize = 0;
+		VkShaderStageFlags PushConstantStages = 0;
+
+		// Compute only. Defaults when specialized, the ids are UINT32_MAX for fixed dimensions.
+		std::array<uint32_t, 3> WorkgroupSize = { 1, 1, 1 };
+		std::array<uint32_t, 3> WorkgroupSizeSpecIds = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+		static ShaderReflection Reflect(const std::vector<uint32_t>& code);
+
+		// Combines the stages of one pipeline, a binding used by several stages must agree on its type
+		void Merge(const ShaderReflection& other);
+
+		uint32_t GetSetCount() const;
+	};
+}
@@ -0,0 +1,145 @@
+#include "ShaderVariants.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace Renderer
+{
+	void ShaderVariantCache::Init(
+		ShaderCompiler& compiler,
+		const std::string& name,
+		const std::string& vertexPath,
+		const std::string& fragmentPath,
+		const std::vector<std::string>& keywords)
+	{
+		if (keywords.size() > sizeof(ShaderKeywordMask) * 8)
+		{
+			throw std::exception("Demasiadas palabras clave para un shader");
+		}
+
+		_compiler = &compiler;
+		_name = name;
+		_vertexPath = vertexPath;
+		_fragmentPath = fragmentPath;
+		_keywords = keywords;
+	}
+
+	std::vector<std::string> ShaderVariantCache::GetDefines(const std::vector<std::string>& keywords, ShaderKeywordMask mask)
+	{
+		std::vector<std::string> defines;
+		for (size_t i = 0; i < keywords.size(); i++)
+		{
+			if (mask & (ShaderKeywordMask(1) << i))
+			{
+				defines.push_back(keywords[i]);
+			}
+		}
+
+		return defines;
+	}
+
+	ShaderKeywordMask ShaderVariantCache::GetKeywordMask(const std::string& keyword) const
+	{
+		for (size_t i = 0; i < _keywords.size(); i++)
+		{
+			if (_keywords[i] == keyword)
+			{
+				return ShaderKeywordMask(1) << i;
+			}
+		}
+
+		spdlog::error("El shader '{0}' no declara la palabra clave '{1}'", _name, keyword);
+		throw std::exception("Palabra clave de shader desconocida");
+	}
+
+	void ShaderVariantCache::Prewarm(ShaderKeywordMask keywords)
+	{
+		std::lock_guard lock(_mutex);
+		FindOrCompile(keywords);
+	}
+
+	std::shared_ptr<Shader> ShaderVariantCache::Get(ShaderKeywordMask keywords)
+	{
+		ShaderFuture vertex;
+		ShaderFuture fragment;
+		uint32_t generation;
+		{
+			std::lock_guard lock(_mutex);
+			Variant& variant = FindOrCompile(keywords);
+			if (variant.Program)
+			{
+				return variant.Program;
+			}
+
+			vertex = variant.Vertex;
+			fragment = variant.Fragment;
+			generation = _generation;
+		}
+
+		// Waited and reflected outside the lock, other variants keep compiling meanwhile
+		std::shared_ptr<Shader> shader;
+		try
+		{
+			shader = Shader::Create(_name, vertex, fragment);
+		}
+		catch (...)
+		{
+			std::lock_guard lock(_mutex);
+			if (generation == _generation)
+			{
+				_variants.erase(keywords);
+			}
+			throw;
+		}
+
+		// A reload in between compiled newer files, this result is not cached
+		std::lock_guard lock(_mutex);
+		auto it = _variants.find(keywords);
+		if (generation != _generation || it == _variants.end())
+		{
+			return shader;
+		}
+
+		if (!it->second.Program)
+		{
+			it->second.Program = shader;
+		}
+
+		return it->second.Program;
+	}
+
+	std::shared_ptr<Shader> ShaderVariantCache::Reload(ShaderKeywordMask keywords)
+	{
+		{
+			std::lock_guard lock(_mutex);
+			_variants.clear();
+			_generation++;
+		}
+
+		return Get(keywords);
+	}
+
+	size_t ShaderVariantCache::GetVariantCount() const
+	{
+		std::lock_guard lock(_mutex);
+		return _variants.size();
+	}
+
+	ShaderVariantCache::Variant& ShaderVariantCache::FindOrCompile(ShaderKeywordMask keywords)
+	{
+		auto it = _variants.find(keywords);
+		if (it != _variants.end())
+		{
+			return it->second;
+		}
+
+		std::vector<std::string> defines = GetDefines(_keywords, keywords);
+
+		Variant variant
+		{
+			.Vertex = _compiler->Compile(_vertexPath, ShaderType::Vertex, defines),
+			.Fragment = _compiler->Compile(_fragmentPath, ShaderType::Fragment, defines),
+		};
+
+		return _variants.emplace(keywords, std::move(variant)).first->second;
+	}
+}
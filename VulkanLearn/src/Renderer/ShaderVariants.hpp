@@ -0,0 +1,69 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+#include "Shader.hpp"
+#include "ShaderCompiler.hpp"
+
+namespace Renderer
+{
+	// Bit i enables the i-th keyword of the shader
+	using ShaderKeywordMask = uint32_t;
+
+	// One vertex/fragment pair compiled once per keyword combination, every enabled keyword is a #define.
+	// Disabled branches are compiled out instead of branching on a uniform at runtime.
+	class ShaderVariantCache
+	{
+	public:
+		void Init(
+			ShaderCompiler& compiler,
+			const std::string& name,
+			const std::string& vertexPath,
+			const std::string& fragmentPath,
+			const std::vector<std::string>& keywords);
+
+		// The defines of one combination, in keyword order
+		static std::vector<std::string> GetDefines(const std::vector<std::string>& keywords, ShaderKeywordMask mask);
+
+		// Throws for keywords the shader did not declare
+		ShaderKeywordMask GetKeywordMask(const std::string& keyword) const;
+
+		// Starts compiling on the workers without waiting, safe from any thread
+		void Prewarm(ShaderKeywordMask keywords);
+
+		// Compiles on demand and blocks until the variant is ready, rethrows the compilation error.
+		// A failed variant is forgotten, the next call compiles it again.
+		std::shared_ptr<Shader> Get(ShaderKeywordMask keywords);
+
+		// The files changed: drops every variant and compiles this one again
+		std::shared_ptr<Shader> Reload(ShaderKeywordMask keywords);
+
+		size_t GetVariantCount() const;
+
+	private:
+		struct Variant
+		{
+			ShaderFuture Vertex;
+			ShaderFuture Fragment;
+			std::shared_ptr<Shader> Program;
+		};
+
+		// Called with the mutex held
+		Variant& FindOrCompile(ShaderKeywordMask keywords);
+
+	private:
+		ShaderCompiler* _compiler = nullptr;
+		std::string _name;
+		std::string _vertexPath;
+		std::string _fragmentPath;
+		std::vector<std::string> _keywords;
+
+		mutable std::mutex _mutex;
+		std::unordered_map<ShaderKeywordMask, Variant> _variants;
+		// Bumped by Reload
+		uint32_t _generation = 0;
+	};
+}
@@ -0,0 +1,61 @@
+#include "ShaderWatcher.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace Renderer
+{
+	void ShaderWatcher::Init(const std::filesystem::path& directory)
+	{
+		_directory = directory;
+		_timestamps.clear();
+
+		// Everything is new on the first scan
+		Scan();
+
+		_lastScan = std::chrono::steady_clock::now().time_since_epoch().count();
+
+		spdlog::info("Observando {0} shaders en {1}", _timestamps.size(), _directory.string());
+	}
+
+	std::vector<std::filesystem::path> ShaderWatcher::Scan()
+	{
+		std::vector<std::filesystem::path> changed;
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(_directory, error))
+		{
+			if (!entry.is_regular_file(error))
+			{
+				continue;
+			}
+
+			auto time = entry.last_write_time(error);
+			if (error)
+			{
+				continue;
+			}
+
+			auto [it, inserted] = _timestamps.try_emplace(entry.path().generic_string(), time);
+			if (inserted || it->second != time)
+			{
+				it->second = time;
+				changed.push_back(entry.path());
+			}
+		}
+
+		return changed;
+	}
+
+	bool ShaderWatcher::ConsumeScanDue()
+	{
+		auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+		auto last = _lastScan.load();
+
+		if (std::chrono::steady_clock::duration(now - last) < SCAN_INTERVAL)
+		{
+			return false;
+		}
+
+		return _lastScan.compare_exchange_strong(last, now);
+	}
+}
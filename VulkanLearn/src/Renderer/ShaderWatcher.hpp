@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+namespace Renderer
+{
+	// Polls a directory for modified files. Scanning a handful of timestamps is cheap,
+	// but it still touches the disk, so Scan belongs on the IO lane.
+	class ShaderWatcher
+	{
+	public:
+		inline static const std::chrono::milliseconds SCAN_INTERVAL{ 500 };
+
+	public:
+		// Records the current timestamps, files already there are not reported as changed
+		void Init(const std::filesystem::path& directory);
+
+		// Files written or created since the previous scan, one thread at a time
+		std::vector<std::filesystem::path> Scan();
+
+		// True once SCAN_INTERVAL has passed, restarts the interval
+		bool ConsumeScanDue();
+
+	private:
+		std::filesystem::path _directory;
+		std::unordered_map<std::string, std::filesystem::file_time_type> _timestamps;
+		std::atomic<std::chrono::steady_clock::rep> _lastScan = 0;
+	};
+}
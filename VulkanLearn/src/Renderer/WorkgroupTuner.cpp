@@ -0,0 +1,229 @@
+#include "WorkgroupTuner.hpp"
+
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "../Common/Hash.hpp"
+#include "../Common/Utils.hpp"
+#include "../Vulkan/Types.hpp"
+
+// Two dimensional shapes, the effects write images
+static const Renderer::WorkgroupSize CANDIDATE_SIZES[] =
+{
+	{ 8, 8, 1 },
+	{ 16, 8, 1 },
+	{ 8, 16, 1 },
+	{ 16, 16, 1 },
+	{ 32, 8, 1 },
+	{ 8, 32, 1 },
+	{ 32, 16, 1 },
+	{ 16, 32, 1 },
+	{ 32, 32, 1 },
+	{ 64, 1, 1 },
+	{ 64, 4, 1 },
+	{ 128, 1, 1 },
+	{ 256, 1, 1 },
+};
+
+namespace Renderer
+{
+	void WorkgroupTuner::Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const std::filesystem::path& directory)
+	{
+		_device = device;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		_timestampPeriod = properties.limits.timestampPeriod;
+		_maxInvocations = properties.limits.maxComputeWorkGroupInvocations;
+		std::copy(std::begin(properties.limits.maxComputeWorkGroupSize), std::end(properties.limits.maxComputeWorkGroupSize), _maxSize.begin());
+
+		// Measured results depend on the driver as much as on the GPU
+		_path = directory / fmt::format("workgroups_{:04x}_{:04x}_{:08x}.txt", properties.vendorID, properties.deviceID, properties.driverVersion);
+		Load();
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+		if (validBits == 0)
+		{
+			spdlog::warn("La cola no admite timestamps, no se ajustan los workgroups");
+			return;
+		}
+
+		_timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+
+		VkQueryPoolCreateInfo queryPoolInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = MAX_CANDIDATES * 2,
+		};
+
+		VK_CHECK(vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &_queryPool));
+	}
+
+	void WorkgroupTuner::Destroy()
+	{
+		if (_queryPool != VK_NULL_HANDLE)
+		{
+			vkDestroyQueryPool(_device, _queryPool, nullptr);
+			_queryPool = VK_NULL_HANDLE;
+		}
+	}
+
+	std::optional<WorkgroupSize> WorkgroupTuner::Find(const std::string& name, uint64_t shaderHash) const
+	{
+		auto it = _results.find(name);
+		if (it == _results.end() || it->second.ShaderHash != shaderHash)
+		{
+			return std::nullopt;
+		}
+
+		return it->second.Size;
+	}
+
+	std::vector<WorkgroupSize> WorkgroupTuner::GetCandidates(const ShaderReflection& reflection) const
+	{
+		std::vector<WorkgroupSize> candidates = { reflection.WorkgroupSize };
+
+		for (WorkgroupSize size : CANDIDATE_SIZES)
+		{
+			for (size_t i = 0; i < size.size(); i++)
+			{
+				if (reflection.WorkgroupSizeSpecIds[i] == UINT32_MAX)
+				{
+					size[i] = reflection.WorkgroupSize[i];
+				}
+			}
+
+			bool fits = size[0] * size[1] * size[2] <= _maxInvocations
+				&& size[0] <= _maxSize[0] && size[1] <= _maxSize[1] && size[2] <= _maxSize[2];
+
+			if (fits && std::find(candidates.begin(), candidates.end(), size) == candidates.end() && candidates.size() < MAX_CANDIDATES)
+			{
+				candidates.push_back(size);
+			}
+		}
+
+		return candidates;
+	}
+
+	void WorkgroupTuner::Record(VkCommandBuffer commandBuffer, std::span<const VkPipeline> pipelines, std::span<const WorkgroupSize> candidates, const DispatchFn& dispatch)
+	{
+		// Each dispatch writes what the previous one wrote, waiting keeps them from overlapping in the measure
+		VkMemoryBarrier2 memoryBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		};
+		VkDependencyInfo dependencyInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &memoryBarrier,
+		};
+
+		vkCmdResetQueryPool(commandBuffer, _queryPool, 0, (uint32_t)pipelines.size() * 2);
+
+		for (size_t i = 0; i < pipelines.size(); i++)
+		{
+			// Warms up caches and lets the driver finish anything deferred to the first use
+			dispatch(commandBuffer, pipelines[i], candidates[i]);
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+			vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, _queryPool, (uint32_t)i * 2);
+			for (uint32_t iteration = 1; iteration < ITERATIONS; iteration++)
+			{
+				dispatch(commandBuffer, pipelines[i], candidates[i]);
+				vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+			}
+			vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, _queryPool, (uint32_t)i * 2 + 1);
+		}
+	}
+
+	size_t WorkgroupTuner::Resolve(const std::string& name, uint64_t shaderHash, std::span<const WorkgroupSize> candidates)
+	{
+		std::vector<uint64_t> timestamps(candidates.size() * 2);
+		VK_CHECK(vkGetQueryPoolResults(_device, _queryPool, 0, (uint32_t)timestamps.size(),
+			timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+		size_t fastest = 0;
+		double fastestMilliseconds = 0.0;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & _timestampMask;
+
+			// Nothing was dispatched or the timer did not advance, the measure says nothing
+			if (ticks == 0)
+			{
+				spdlog::warn("Workgroup {0}x{1}x{2} de '{3}' sin tiempo medido, no se guarda el ajuste", candidates[i][0], candidates[i][1], candidates[i][2], name);
+				return 0;
+			}
+
+			double milliseconds = ticks * (double)_timestampPeriod / 1e6 / (ITERATIONS - 1);
+
+			spdlog::debug("Workgroup {0}x{1}x{2} de '{3}': {4:.4f} ms", candidates[i][0], candidates[i][1], candidates[i][2], name, milliseconds);
+
+			if (i == 0 || milliseconds < fastestMilliseconds)
+			{
+				fastest = i;
+				fastestMilliseconds = milliseconds;
+			}
+		}
+
+		const WorkgroupSize& size = candidates[fastest];
+		spdlog::info("Workgroup de '{0}' ajustado a {1}x{2}x{3} ({4:.4f} ms)", name, size[0], size[1], size[2], fastestMilliseconds);
+
+		_results[name] = Result{ .ShaderHash = shaderHash, .Size = size };
+		Save();
+
+		return fastest;
+	}
+
+	void WorkgroupTuner::Load()
+	{
+		std::ifstream file(_path);
+		if (!file.is_open())
+		{
+			return;
+		}
+
+		// One effect per line: name, shader hash and size
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+
+			std::string name;
+			Result result;
+			if (stream >> name >> std::hex >> result.ShaderHash >> std::dec >> result.Size[0] >> result.Size[1] >> result.Size[2])
+			{
+				_results[name] = result;
+			}
+		}
+
+		spdlog::info("{0} workgroups ajustados cargados de {1}", _results.size(), _path.string());
+	}
+
+	void WorkgroupTuner::Save() const
+	{
+		std::string text;
+		for (const auto& [name, result] : _results)
+		{
+			text += fmt::format("{} {} {} {} {}\n", name, Common::Hash::toHex(result.ShaderHash), result.Size[0], result.Size[1], result.Size[2]);
+		}
+
+		Common::Utils::writeFileAtomic(_path, text.data(), text.size());
+	}
+}
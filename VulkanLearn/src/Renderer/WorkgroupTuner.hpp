@@ -0,0 +1,71 @@
+#pragma once
+#include <span>
+#include <array>
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.hpp"
+
+namespace Renderer
+{
+	using WorkgroupSize = std::array<uint32_t, 3>;
+
+	// Times a compute shader at several workgroup sizes with timestamp queries and keeps the fastest.
+	// Results are saved per device and driver, and per shader code, so an edit or a new driver tunes again.
+	class WorkgroupTuner
+	{
+	public:
+		// Dispatches per candidate, the first one is not timed
+		static const uint32_t ITERATIONS = 8;
+		static const uint32_t MAX_CANDIDATES = 16;
+
+		// Binds the candidate pipeline and dispatches it over the whole target
+		using DispatchFn = std::function<void(VkCommandBuffer, VkPipeline, const WorkgroupSize&)>;
+
+	public:
+		// queueFamilyIndex: where the tuning command buffer is submitted
+		void Init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const std::filesystem::path& directory);
+		void Destroy();
+
+		// False when the queue family has no timestamps, the shader defaults are kept
+		inline bool CanTime() const { return _queryPool != VK_NULL_HANDLE; }
+
+		std::optional<WorkgroupSize> Find(const std::string& name, uint64_t shaderHash) const;
+
+		// The shader default first, then the sizes the device allows. Fixed dimensions keep their value.
+		std::vector<WorkgroupSize> GetCandidates(const ShaderReflection& reflection) const;
+
+		// Every pipeline between two timestamps, with the previous dispatch finished before the next one starts
+		void Record(VkCommandBuffer commandBuffer, std::span<const VkPipeline> pipelines, std::span<const WorkgroupSize> candidates, const DispatchFn& dispatch);
+
+		// After the recorded command buffer has completed. Stores the fastest candidate and returns its index,
+		// or the shader default without storing anything when a candidate measured no time.
+		size_t Resolve(const std::string& name, uint64_t shaderHash, std::span<const WorkgroupSize> candidates);
+
+	private:
+		struct Result
+		{
+			uint64_t ShaderHash;
+			WorkgroupSize Size;
+		};
+
+		void Load();
+		void Save() const;
+
+	private:
+		VkDevice _device = VK_NULL_HANDLE;
+		VkQueryPool _queryPool = VK_NULL_HANDLE;
+		uint64_t _timestampMask = 0;
+		float _timestampPeriod = 0.f;
+		uint32_t _maxInvocations = 0;
+		WorkgroupSize _maxSize = {};
+
+		std::filesystem::path _path;
+		std::unordered_map<std::string, Result> _results;
+	};
+}
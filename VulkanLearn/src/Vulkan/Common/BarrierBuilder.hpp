@@ -0,0 +1,266 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "../Types.hpp"
+#include "../Init.hpp"
+
+namespace Vulkan::Common
+{
+	struct ResourceState
+	{
+		VkPipelineStageFlags2 Stage;
+		VkAccessFlags2 Access;
+		VkImageLayout Layout;
+
+		inline bool operator==(const ResourceState& other) const
+		{
+			return Stage == other.Stage && Access == other.Access && Layout == other.Layout;
+		}
+	};
+
+	namespace ResourceStates
+	{
+		inline constexpr ResourceState Undefined
+		{
+			.Stage = VK_PIPELINE_STAGE_2_NONE,
+			.Access = VK_ACCESS_2_NONE,
+			.Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		// Swapchain images are acquired through a semaphore waited at the color output stage
+		inline constexpr ResourceState SwapchainAcquire
+		{
+			.Stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.Access = VK_ACCESS_2_NONE,
+			.Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		inline constexpr ResourceState ClearWrite
+		{
+			.Stage = VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			.Access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.Layout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		inline constexpr ResourceState ComputeWrite
+		{
+			.Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.Access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.Layout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		inline constexpr ResourceState ComputeRead
+		{
+			.Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+			.Layout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		inline constexpr ResourceState FragmentShaderRead
+		{
+			.Stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			.Access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			.Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		};
+
+		inline constexpr ResourceState ColorAttachment
+		{
+			.Stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.Access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			.Layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		};
+
+		inline constexpr ResourceState DepthAttachment
+		{
+			.Stage = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			.Access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.Layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+		};
+
+		inline constexpr ResourceState TransferSrc
+		{
+			.Stage = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+			.Access = VK_ACCESS_2_TRANSFER_READ_BIT,
+			.Layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		};
+
+		inline constexpr ResourceState TransferDst
+		{
+			.Stage = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+			.Access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.Layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		};
+
+		inline constexpr ResourceState Present
+		{
+			.Stage = VK_PIPELINE_STAGE_2_NONE,
+			.Access = VK_ACCESS_2_NONE,
+			.Layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		};
+
+		inline constexpr ResourceState VertexShaderRead
+		{
+			.Stage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+			.Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+			.Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+
+		inline constexpr ResourceState IndexRead
+		{
+			.Stage = VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+			.Access = VK_ACCESS_2_INDEX_READ_BIT,
+			.Layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		};
+	}
+
+	inline static bool isWriteAccess(VkAccessFlags2 access)
+	{
+		constexpr VkAccessFlags2 writeBits = VK_ACCESS_2_SHADER_WRITE_BIT
+			| VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			| VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_2_TRANSFER_WRITE_BIT
+			| VK_ACCESS_2_HOST_WRITE_BIT
+			| VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		return (access & writeBits) != 0;
+	}
+
+	class BarrierBuilder
+	{
+	public:
+		// discard: the previous contents are not needed, the image is transitioned from UNDEFINED
+		// while still waiting on the stages of its previous use
+		inline BarrierBuilder& Image(
+			VkImage image,
+			const ResourceState& from,
+			const ResourceState& to,
+			bool discard = false,
+			VkImageAspectFlags aspectMask = 0)
+		{
+			if (aspectMask == 0)
+			{
+				aspectMask = (to.Layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || to.Layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL)
+					? VK_IMAGE_ASPECT_DEPTH_BIT
+					: VK_IMAGE_ASPECT_COLOR_BIT;
+			}
+
+			VkImageMemoryBarrier2 barrier
+			{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+				.pNext = nullptr,
+				.srcStageMask = from.Stage,
+				.srcAccessMask = isWriteAccess(from.Access) ? from.Access : VK_ACCESS_2_NONE,
+				.dstStageMask = to.Stage,
+				.dstAccessMask = to.Access,
+				.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : from.Layout,
+				.newLayout = to.Layout,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image,
+				.subresourceRange = Vulkan::Init::imageSubresourceRange(aspectMask),
+			};
+
+			_imageBarriers.push_back(barrier);
+
+			return *this;
+		}
+
+		inline BarrierBuilder& Buffer(
+			VkBuffer buffer,
+			const ResourceState& from,
+			const ResourceState& to,
+			VkDeviceSize offset = 0,
+			VkDeviceSize size = VK_WHOLE_SIZE)
+		{
+			// Read after read needs no synchronization
+			if (!isWriteAccess(from.Access) && !isWriteAccess(to.Access))
+			{
+				return *this;
+			}
+
+			VkBufferMemoryBarrier2 barrier
+			{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				.pNext = nullptr,
+				.srcStageMask = from.Stage,
+				.srcAccessMask = isWriteAccess(from.Access) ? from.Access : VK_ACCESS_2_NONE,
+				.dstStageMask = to.Stage,
+				.dstAccessMask = to.Access,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.buffer = buffer,
+				.offset = offset,
+				.size = size,
+			};
+
+			_bufferBarriers.push_back(barrier);
+
+			return *this;
+		}
+
+		inline BarrierBuilder& Memory(const ResourceState& from, const ResourceState& to)
+		{
+			VkMemoryBarrier2 barrier
+			{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.pNext = nullptr,
+				.srcStageMask = from.Stage,
+				.srcAccessMask = isWriteAccess(from.Access) ? from.Access : VK_ACCESS_2_NONE,
+				.dstStageMask = to.Stage,
+				.dstAccessMask = to.Access,
+			};
+
+			_memoryBarriers.push_back(barrier);
+
+			return *this;
+		}
+
+		inline bool Empty() const
+		{
+			return _imageBarriers.empty() && _bufferBarriers.empty() && _memoryBarriers.empty();
+		}
+
+		inline size_t Count() const
+		{
+			return _imageBarriers.size() + _bufferBarriers.size() + _memoryBarriers.size();
+		}
+
+		// Records every pending barrier in a single dependency info and clears the builder
+		inline void Flush(VkCommandBuffer cmd)
+		{
+			if (Empty())
+			{
+				return;
+			}
+
+			VkDependencyInfo depInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.pNext = nullptr,
+				.memoryBarrierCount = (uint32_t)_memoryBarriers.size(),
+				.pMemoryBarriers = _memoryBarriers.data(),
+				.bufferMemoryBarrierCount = (uint32_t)_bufferBarriers.size(),
+				.pBufferMemoryBarriers = _bufferBarriers.data(),
+				.imageMemoryBarrierCount = (uint32_t)_imageBarriers.size(),
+				.pImageMemoryBarriers = _imageBarriers.data(),
+			};
+
+			vkCmdPipelineBarrier2(cmd, &depInfo);
+
+			Clear();
+		}
+
+		inline void Clear()
+		{
+			_imageBarriers.clear();
+			_bufferBarriers.clear();
+			_memoryBarriers.clear();
+		}
+
+	private:
+		std::vector<VkImageMemoryBarrier2> _imageBarriers;
+		std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+		std::vector<VkMemoryBarrier2> _memoryBarriers;
+	};
+}
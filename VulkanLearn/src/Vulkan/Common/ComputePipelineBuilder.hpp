@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include "../Types.hpp"
+#include "../Init.hpp"
+#include "SpecializationConstants.hpp"
+
+namespace Vulkan::Common
+{
+	class ComputePipelineBuilder
+	{
+	public:
+        inline ComputePipelineBuilder(VkPipelineLayout pipelineLayout) :
+            _pipelineLayout(pipelineLayout)
+        {
+        }
+
+        inline VkPipeline Build(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE) const
+        {
+            VkSpecializationInfo specialization = _specialization.GetInfo();
+
+            VkPipelineShaderStageCreateInfo stage = Vulkan::Init::pipelineShaderStageCreateInfo(_shader, VK_SHADER_STAGE_COMPUTE_BIT);
+            stage.pSpecializationInfo = _specialization.Empty() ? nullptr : &specialization;
+
+            VkComputePipelineCreateInfo pipelineInfo
+            {
+                .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                .stage = stage,
+                .layout = _pipelineLayout,
+            };
+
+            VkPipeline pipeline;
+            VK_CHECK(vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline));
+
+            return pipeline;
+        }
+
+        inline ComputePipelineBuilder& SetShader(VkShaderModule shader)
+        {
+            _shader = shader;
+
+            return *this;
+        }
+
+        inline ComputePipelineBuilder& SetSpecialization(const SpecializationConstants& constants)
+        {
+            _specialization = constants;
+
+            return *this;
+        }
+
+	private:
+        VkPipelineLayout _pipelineLayout;
+        VkShaderModule _shader = VK_NULL_HANDLE;
+        SpecializationConstants _specialization;
+	};
+}
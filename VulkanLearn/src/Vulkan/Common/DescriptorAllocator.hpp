@@ -1,70 +1,175 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <span>
+#include <string>
 #include <vector>
+#include <algorithm>
 #include "../Types.hpp"
 
 namespace Vulkan::Common
 {
-    class DescriptorAllocator 
+    // Keeps a list of pools and creates a bigger one whenever the current one runs out,
+    // so allocation never fails for lack of space. Not thread safe.
+    // Sets are never freed one by one, the pools lack FREE_DESCRIPTOR_SET so drivers can allocate linearly
+    // and ClearPools releases everything at once.
+    class DescriptorAllocator
     {
     public:
+        static const uint32_t MAX_SETS_PER_POOL = 4092;
 
+        // Descriptors of each type per set
         struct PoolSizeRatio {
             VkDescriptorType type;
             float ratio;
         };
 
-        VkDescriptorPool Pool;
+        // initialSets: sets in the first pool, each new pool grows by half
+        inline void Init(VkDevice device, uint32_t initialSets, std::span<const PoolSizeRatio> poolRatios)
+        {
+            _ratios.assign(poolRatios.begin(), poolRatios.end());
+
+            _readyPools.push_back(CreatePool(device, initialSets));
+            _setsPerPool = GrowSetCount(initialSets);
+        }
+
+        // Every set allocated so far becomes invalid, the pools are kept for the next allocations
+        inline void ClearPools(VkDevice device)
+        {
+            for (VkDescriptorPool pool : _readyPools)
+            {
+                VK_CHECK(vkResetDescriptorPool(device, pool, 0));
+            }
+            for (VkDescriptorPool pool : _fullPools)
+            {
+                VK_CHECK(vkResetDescriptorPool(device, pool, 0));
+                _readyPools.push_back(pool);
+            }
+            _fullPools.clear();
+        }
 
-        inline void InitPool(VkDevice device, uint32_t maxSets, std::span<PoolSizeRatio> poolRatios)
+        inline void DestroyPools(VkDevice device)
         {
-			std::vector<VkDescriptorPoolSize> poolSizes(poolRatios.size());
-            for (size_t i = 0; i < poolRatios.size(); i++) 
+            for (VkDescriptorPool pool : _readyPools)
             {
-				poolSizes[i] =
-				{
-					.type = poolRatios[i].type,
-					.descriptorCount = (uint32_t)(maxSets * poolRatios[i].ratio),
-				};
+                vkDestroyDescriptorPool(device, pool, nullptr);
             }
+            _readyPools.clear();
 
-			VkDescriptorPoolCreateInfo info
-			{
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-                .flags = 0,
-				.maxSets = maxSets,
-				.poolSizeCount = (uint32_t)poolSizes.size(),
-				.pPoolSizes = poolSizes.data(),
-			};
+            for (VkDescriptorPool pool : _fullPools)
+            {
+                vkDestroyDescriptorPool(device, pool, nullptr);
+            }
+            _fullPools.clear();
+        }
+
+        inline VkDescriptorSet Allocate(VkDevice device, VkDescriptorSetLayout layout, const void* pNext = nullptr)
+        {
+            VkDescriptorPool pool = GetPool(device);
+
+            VkDescriptorSetAllocateInfo info
+            {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .pNext = pNext,
+                .descriptorPool = pool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &layout,
+            };
+
+            VkDescriptorSet set;
+            VkResult result = vkAllocateDescriptorSets(device, &info, &set);
+
+            // Full, it is only tried again after a reset
+            if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+            {
+                _fullPools.push_back(pool);
+
+                pool = GetPool(device);
+                info.descriptorPool = pool;
+
+                result = vkAllocateDescriptorSets(device, &info, &set);
 
-			VK_CHECK(vkCreateDescriptorPool(device, &info, nullptr, &Pool));
+                // Not even an empty pool fits it, the layout uses a type missing from the ratios or more descriptors than they give
+                if (result != VK_SUCCESS)
+                {
+                    _fullPools.push_back(pool);
+                    LogMissingSpace(layout, result);
+                    VK_CHECK(result);
+                }
+            }
+            else
+            {
+                VK_CHECK(result);
+            }
+
+            _readyPools.push_back(pool);
+
+            return set;
         }
 
-        inline void ClearDescriptors(VkDevice device)
+    private:
+        inline VkDescriptorPool GetPool(VkDevice device)
         {
-            VK_CHECK(vkResetDescriptorPool(device, Pool, 0));
+            if (!_readyPools.empty())
+            {
+                VkDescriptorPool pool = _readyPools.back();
+                _readyPools.pop_back();
+                return pool;
+            }
+
+            VkDescriptorPool pool = CreatePool(device, _setsPerPool);
+            _setsPerPool = GrowSetCount(_setsPerPool);
+
+            return pool;
         }
 
-        inline void DestroyPool(VkDevice device)
+        inline VkDescriptorPool CreatePool(VkDevice device, uint32_t setCount) const
         {
-            vkDestroyDescriptorPool(device, Pool, nullptr);
+            std::vector<VkDescriptorPoolSize> poolSizes(_ratios.size());
+            for (size_t i = 0; i < _ratios.size(); i++)
+            {
+                poolSizes[i] =
+                {
+                    .type = _ratios[i].type,
+                    .descriptorCount = std::max(1u, (uint32_t)(setCount * _ratios[i].ratio)),
+                };
+            }
+
+            VkDescriptorPoolCreateInfo info
+            {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                .flags = 0,
+                .maxSets = setCount,
+                .poolSizeCount = (uint32_t)poolSizes.size(),
+                .pPoolSizes = poolSizes.data(),
+            };
+
+            VkDescriptorPool pool;
+            VK_CHECK(vkCreateDescriptorPool(device, &info, nullptr, &pool));
+
+            return pool;
         }
 
-        inline VkDescriptorSet Allocate(VkDevice device, VkDescriptorSetLayout layout)
+        inline void LogMissingSpace(VkDescriptorSetLayout layout, VkResult result) const
         {
-			VkDescriptorSetAllocateInfo info
-			{
-				.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-				.descriptorPool = Pool,
-				.descriptorSetCount = 1,
-				.pSetLayouts = &layout,
-			};
-
-			VkDescriptorSet set;
-			VK_CHECK(vkAllocateDescriptorSets(device, &info, &set));
-
-			return set;
+            std::string types;
+            for (const auto& ratio : _ratios)
+            {
+                types += fmt::format(" {0} x{1}", string_VkDescriptorType(ratio.type), ratio.ratio);
+            }
+
+            spdlog::error("El set con layout {0} no cabe en un pool vacio ({1}), tipos por set:{2}",
+                fmt::ptr(layout), string_VkResult(result), types);
         }
+
+        inline static uint32_t GrowSetCount(uint32_t setCount)
+        {
+            return std::min(setCount + std::max(1u, setCount / 2), MAX_SETS_PER_POOL);
+        }
+
+    private:
+        std::vector<PoolSizeRatio> _ratios;
+        std::vector<VkDescriptorPool> _fullPools;
+        std::vector<VkDescriptorPool> _readyPools;
+        uint32_t _setsPerPool = 0;
     };
-}
\ No newline at end of file
+}
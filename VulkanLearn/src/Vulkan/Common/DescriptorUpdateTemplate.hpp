@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "../Types.hpp"
+
+namespace Vulkan::Common
+{
+    // Writes every binding of a set from one packed struct in a single call, without building
+    // VkWriteDescriptorSet arrays. Meant for layouts whose sets are written again every frame.
+    class DescriptorUpdateTemplate
+    {
+    public:
+        // offset: where the VkDescriptorImageInfo or VkDescriptorBufferInfo of the binding is in the struct.
+        // stride: distance between the elements of an array binding
+        inline DescriptorUpdateTemplate& AddEntry(
+            uint32_t binding,
+            VkDescriptorType type,
+            size_t offset,
+            uint32_t count = 1,
+            size_t stride = 0)
+        {
+            _entries.push_back(
+                {
+                    .dstBinding = binding,
+                    .dstArrayElement = 0,
+                    .descriptorCount = count,
+                    .descriptorType = type,
+                    .offset = offset,
+                    .stride = stride,
+                });
+
+            return *this;
+        }
+
+        inline void Build(VkDevice device, VkDescriptorSetLayout layout)
+        {
+            VkDescriptorUpdateTemplateCreateInfo info
+            {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+                .descriptorUpdateEntryCount = (uint32_t)_entries.size(),
+                .pDescriptorUpdateEntries = _entries.data(),
+                .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+                .descriptorSetLayout = layout,
+            };
+
+            VK_CHECK(vkCreateDescriptorUpdateTemplate(device, &info, nullptr, &_template));
+        }
+
+        inline void Destroy(VkDevice device)
+        {
+            vkDestroyDescriptorUpdateTemplate(device, _template, nullptr);
+            _template = VK_NULL_HANDLE;
+        }
+
+        // data: the struct described by the entries
+        template<typename T>
+        inline void Update(VkDevice device, VkDescriptorSet set, const T& data) const
+        {
+            vkUpdateDescriptorSetWithTemplate(device, set, _template, &data);
+        }
+
+    private:
+        std::vector<VkDescriptorUpdateTemplateEntry> _entries;
+        VkDescriptorUpdateTemplate _template = VK_NULL_HANDLE;
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "../Types.hpp"
+
+namespace Vulkan::Common
+{
+    // Accumulates descriptor writes to any number of sets and applies them with a single vkUpdateDescriptorSets
+    class DescriptorWriter
+    {
+    public:
+        // sampler is ignored by types that do not use one
+        inline DescriptorWriter& WriteImage(
+            VkDescriptorSet set,
+            uint32_t binding,
+            VkImageView imageView,
+            VkSampler sampler,
+            VkImageLayout layout,
+            VkDescriptorType type)
+        {
+            // A deque keeps the infos in place while more are added, the writes point to them
+            VkDescriptorImageInfo& info = _imageInfos.emplace_back(VkDescriptorImageInfo
+                {
+                    .sampler = sampler,
+                    .imageView = imageView,
+                    .imageLayout = layout,
+                });
+
+            _writes.push_back(
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = set,
+                    .dstBinding = binding,
+                    .descriptorCount = 1,
+                    .descriptorType = type,
+                    .pImageInfo = &info,
+                });
+
+            return *this;
+        }
+
+        inline DescriptorWriter& WriteBuffer(
+            VkDescriptorSet set,
+            uint32_t binding,
+            VkBuffer buffer,
+            VkDeviceSize size,
+            VkDeviceSize offset,
+            VkDescriptorType type)
+        {
+            VkDescriptorBufferInfo& info = _bufferInfos.emplace_back(VkDescriptorBufferInfo
+                {
+                    .buffer = buffer,
+                    .offset = offset,
+                    .range = size,
+                });
+
+            _writes.push_back(
+                {
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = set,
+                    .dstBinding = binding,
+                    .descriptorCount = 1,
+                    .descriptorType = type,
+                    .pBufferInfo = &info,
+                });
+
+            return *this;
+        }
+
+        // Applies every pending write and clears them
+        inline void Flush(VkDevice device)
+        {
+            if (!_writes.empty())
+            {
+                vkUpdateDescriptorSets(device, (uint32_t)_writes.size(), _writes.data(), 0, nullptr);
+            }
+
+            Clear();
+        }
+
+        inline void Clear()
+        {
+            _imageInfos.clear();
+            _bufferInfos.clear();
+            _writes.clear();
+        }
+
+    private:
+        std::deque<VkDescriptorImageInfo> _imageInfos;
+        std::deque<VkDescriptorBufferInfo> _bufferInfos;
+        std::vector<VkWriteDescriptorSet> _writes;
+    };
+}
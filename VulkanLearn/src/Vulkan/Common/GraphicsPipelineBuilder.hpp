@@ -1,8 +1,11 @@
 #pragma once
+#include <span>
 #include <vector>
 #include <vulkan/vulkan.h>
 #include "../Types.hpp"
 #include "../Init.hpp"
+#include "../../Common/Hash.hpp"
+#include "SpecializationConstants.hpp"
 
 namespace Vulkan::Common 
 {
@@ -16,8 +19,157 @@ namespace Vulkan::Common
 			_pipelineLayout = pipelineLayout;
         }
 
-		inline VkPipeline Build(VkDevice device)
+		inline VkPipeline Build(VkDevice device, VkPipelineCache cache = VK_NULL_HANDLE) const
 		{
+            return Create(device, cache, 0, nullptr, VK_SHADER_STAGE_ALL_GRAPHICS);
+        }
+
+        // VK_EXT_graphics_pipeline_library: compiles only the given parts of the state, the rest is ignored.
+        // Libraries keep what the optimized Link needs.
+        inline VkPipeline BuildLibrary(VkDevice device, VkGraphicsPipelineLibraryFlagsEXT parts, VkPipelineCache cache = VK_NULL_HANDLE) const
+        {
+            VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo
+            {
+                .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                .flags = parts,
+            };
+
+            VkShaderStageFlags stages = 0;
+            if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT)
+            {
+                stages |= VK_SHADER_STAGE_VERTEX_BIT;
+            }
+            if (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT)
+            {
+                stages |= VK_SHADER_STAGE_FRAGMENT_BIT;
+            }
+
+            return Create(
+                device,
+                cache,
+                VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,
+                &libraryInfo,
+                stages);
+        }
+
+        // Links one library of every part. The fast link is cheap enough for the frame that needs it,
+        // the optimized one runs as fast as a monolithic pipeline and belongs in the background.
+        inline static VkPipeline Link(
+            VkDevice device,
+            VkPipelineLayout pipelineLayout,
+            std::span<const VkPipeline> libraries,
+            bool optimized,
+            VkPipelineCache cache = VK_NULL_HANDLE)
+        {
+            VkPipelineLibraryCreateInfoKHR libraryInfo
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+                .libraryCount = (uint32_t)libraries.size(),
+                .pLibraries = libraries.data(),
+            };
+
+            VkGraphicsPipelineCreateInfo pipelineInfo
+            {
+                .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                .pNext = &libraryInfo,
+                .flags = optimized ? VkPipelineCreateFlags(VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT) : VkPipelineCreateFlags(0),
+                .layout = pipelineLayout,
+            };
+
+            VkPipeline pipeline;
+            VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline))
+
+            return pipeline;
+        }
+
+        // Every piece of state Build uses. Shader modules are included only once set, so a cache can
+        // hash the fixed function state first and key the shaders by their code instead of by handle.
+        inline uint64_t Hash() const
+        {
+            uint64_t hash = HashVertexInput();
+            hash = ::Common::Hash::fnv1aValue(HashPreRasterization(), hash);
+            hash = ::Common::Hash::fnv1aValue(HashFragmentShader(), hash);
+            hash = ::Common::Hash::fnv1aValue(HashFragmentOutput(), hash);
+
+            return hash;
+        }
+
+        // The state of each pipeline library part, equal hashes can share the library
+        inline uint64_t HashVertexInput() const
+        {
+            using namespace ::Common::Hash;
+
+            uint64_t hash = fnv1aValue(_inputAssembly.topology);
+            hash = fnv1aValue(_inputAssembly.primitiveRestartEnable, hash);
+
+            return hash;
+        }
+
+        inline uint64_t HashPreRasterization() const
+        {
+            using namespace ::Common::Hash;
+
+            uint64_t hash = fnv1aValue(_pipelineLayout);
+            hash = HashStage(VK_SHADER_STAGE_VERTEX_BIT, _vertexSpecialization, hash);
+
+            hash = fnv1aValue(_rasterizer.polygonMode, hash);
+            hash = fnv1aValue(_rasterizer.lineWidth, hash);
+            hash = fnv1aValue(_rasterizer.cullMode, hash);
+            hash = fnv1aValue(_rasterizer.frontFace, hash);
+
+            return hash;
+        }
+
+        inline uint64_t HashFragmentShader() const
+        {
+            using namespace ::Common::Hash;
+
+            uint64_t hash = fnv1aValue(_pipelineLayout);
+            hash = HashStage(VK_SHADER_STAGE_FRAGMENT_BIT, _fragmentSpecialization, hash);
+            hash = HashMultisampling(hash);
+
+            hash = fnv1aValue(_depthStencil.depthTestEnable, hash);
+            hash = fnv1aValue(_depthStencil.depthWriteEnable, hash);
+            hash = fnv1aValue(_depthStencil.depthCompareOp, hash);
+            hash = fnv1aValue(_depthStencil.depthBoundsTestEnable, hash);
+            hash = fnv1aValue(_depthStencil.stencilTestEnable, hash);
+            hash = fnv1aValue(_depthStencil.minDepthBounds, hash);
+            hash = fnv1aValue(_depthStencil.maxDepthBounds, hash);
+
+            return hash;
+        }
+
+        inline uint64_t HashFragmentOutput() const
+        {
+            using namespace ::Common::Hash;
+
+            uint64_t hash = HashMultisampling(FNV_OFFSET);
+
+            hash = fnv1aValue(_colorBlendAttachment.blendEnable, hash);
+            hash = fnv1aValue(_colorBlendAttachment.srcColorBlendFactor, hash);
+            hash = fnv1aValue(_colorBlendAttachment.dstColorBlendFactor, hash);
+            hash = fnv1aValue(_colorBlendAttachment.colorBlendOp, hash);
+            hash = fnv1aValue(_colorBlendAttachment.srcAlphaBlendFactor, hash);
+            hash = fnv1aValue(_colorBlendAttachment.dstAlphaBlendFactor, hash);
+            hash = fnv1aValue(_colorBlendAttachment.alphaBlendOp, hash);
+            hash = fnv1aValue(_colorBlendAttachment.colorWriteMask, hash);
+
+            hash = fnv1aValue(_renderInfo.colorAttachmentCount, hash);
+            if (_renderInfo.colorAttachmentCount > 0)
+            {
+                hash = fnv1aValue(_colorAttachmentformat, hash);
+            }
+            hash = fnv1aValue(_renderInfo.depthAttachmentFormat, hash);
+            hash = fnv1aValue(_renderInfo.stencilAttachmentFormat, hash);
+
+            return hash;
+        }
+
+        inline VkPipelineLayout GetPipelineLayout() const { return _pipelineLayout; }
+
+	private:
+        inline VkPipeline Create(VkDevice device, VkPipelineCache cache, VkPipelineCreateFlags flags, const void* next, VkShaderStageFlags stageMask) const
+        {
             VkPipelineViewportStateCreateInfo viewportState
             {
                 .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -46,12 +198,42 @@ namespace Vulkan::Common
                 .pDynamicStates = &state[0],
             };
 
+            // Points at this builder's format, a copied builder would still point at the original
+            VkPipelineRenderingCreateInfo renderInfo = _renderInfo;
+            renderInfo.pNext = next;
+            renderInfo.pColorAttachmentFormats = renderInfo.colorAttachmentCount > 0 ? &_colorAttachmentformat : nullptr;
+
+            VkSpecializationInfo vertexSpecialization = _vertexSpecialization.GetInfo();
+            VkSpecializationInfo fragmentSpecialization = _fragmentSpecialization.GetInfo();
+
+            std::vector<VkPipelineShaderStageCreateInfo> stages;
+            for (const auto& shaderStage : _shaderStages)
+            {
+                if (shaderStage.stage & stageMask)
+                {
+                    stages.push_back(shaderStage);
+                }
+            }
+
+            for (auto& stage : stages)
+            {
+                if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT && !_vertexSpecialization.Empty())
+                {
+                    stage.pSpecializationInfo = &vertexSpecialization;
+                }
+                else if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT && !_fragmentSpecialization.Empty())
+                {
+                    stage.pSpecializationInfo = &fragmentSpecialization;
+                }
+            }
+
             VkGraphicsPipelineCreateInfo pipelineInfo
             { 
                 .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-                .pNext = &_renderInfo,
-                .stageCount = (uint32_t)_shaderStages.size(),
-                .pStages = _shaderStages.data(),
+                .pNext = &renderInfo,
+                .flags = flags,
+                .stageCount = (uint32_t)stages.size(),
+                .pStages = stages.data(),
                 .pVertexInputState = &_vertexInputInfo,
                 .pInputAssemblyState = &_inputAssembly,
                 .pViewportState = &viewportState,
@@ -64,11 +246,12 @@ namespace Vulkan::Common
 			};
 
             VkPipeline pipeline;
-			VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline))
+			VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline))
 
 			return pipeline;
 		}
 
+	public:
         inline GraphicsPipelineBuilder& SetShaders(VkShaderModule vertexShader, VkShaderModule fragmentShader)
         {
             _shaderStages.clear();
@@ -82,6 +265,21 @@ namespace Vulkan::Common
             return *this;
         }
 
+        // Kept apart from the modules, SetShaders does not reset them
+        inline GraphicsPipelineBuilder& SetSpecialization(VkShaderStageFlagBits stage, const SpecializationConstants& constants)
+        {
+            if (stage == VK_SHADER_STAGE_VERTEX_BIT)
+            {
+                _vertexSpecialization = constants;
+            }
+            else if (stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+            {
+                _fragmentSpecialization = constants;
+            }
+
+            return *this;
+        }
+
         inline GraphicsPipelineBuilder& SetInputTopology(VkPrimitiveTopology topology)
         {
             _inputAssembly.topology = topology;
@@ -221,8 +419,37 @@ namespace Vulkan::Common
             _depthStencil = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
             _renderInfo = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
 			_shaderStages.clear();
+            _vertexSpecialization = {};
+            _fragmentSpecialization = {};
 		}
 
+	private:
+        inline uint64_t HashStage(VkShaderStageFlagBits stage, const SpecializationConstants& specialization, uint64_t hash) const
+        {
+            for (const auto& shaderStage : _shaderStages)
+            {
+                if (shaderStage.stage == stage)
+                {
+                    hash = ::Common::Hash::fnv1aValue(shaderStage.module, hash);
+                }
+            }
+
+            return specialization.Hash(::Common::Hash::fnv1aValue(stage, hash));
+        }
+
+        inline uint64_t HashMultisampling(uint64_t hash) const
+        {
+            using namespace ::Common::Hash;
+
+            hash = fnv1aValue(_multisampling.rasterizationSamples, hash);
+            hash = fnv1aValue(_multisampling.sampleShadingEnable, hash);
+            hash = fnv1aValue(_multisampling.minSampleShading, hash);
+            hash = fnv1aValue(_multisampling.alphaToCoverageEnable, hash);
+            hash = fnv1aValue(_multisampling.alphaToOneEnable, hash);
+
+            return hash;
+        }
+
 	private:
         std::vector<VkPipelineShaderStageCreateInfo> _shaderStages;
 
@@ -234,5 +461,7 @@ namespace Vulkan::Common
         VkPipelineDepthStencilStateCreateInfo _depthStencil;
         VkPipelineRenderingCreateInfo _renderInfo;
         VkFormat _colorAttachmentformat;
+        SpecializationConstants _vertexSpecialization;
+        SpecializationConstants _fragmentSpecialization;
 	};
 }
\ No newline at end of file
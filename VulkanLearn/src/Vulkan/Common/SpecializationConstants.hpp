@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <vulkan/vulkan.h>
+#include "../../Common/Hash.hpp"
+
+namespace Vulkan::Common
+{
+    // constant_id -> value map for one shader stage, kept sorted by id so equal maps hash equally
+    class SpecializationConstants
+    {
+    public:
+        template<typename T>
+        inline SpecializationConstants& Set(uint32_t id, T value)
+        {
+            static_assert(std::is_arithmetic_v<T>, "Specialization constants are scalars");
+
+            // GLSL bool constants are 32 bit
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                return SetBytes(id, VkBool32(value ? VK_TRUE : VK_FALSE));
+            }
+            else
+            {
+                return SetBytes(id, value);
+            }
+        }
+
+        inline bool Empty() const { return _entries.empty(); }
+
+        // Points into this object, valid while it is alive and unchanged
+        inline VkSpecializationInfo GetInfo() const
+        {
+            return VkSpecializationInfo
+            {
+                .mapEntryCount = (uint32_t)_entries.size(),
+                .pMapEntries = _entries.data(),
+                .dataSize = _data.size(),
+                .pData = _data.data(),
+            };
+        }
+
+        inline uint64_t Hash(uint64_t seed = ::Common::Hash::FNV_OFFSET) const
+        {
+            uint64_t hash = seed;
+            for (const auto& entry : _entries)
+            {
+                hash = ::Common::Hash::fnv1aValue(entry.constantID, hash);
+                hash = ::Common::Hash::fnv1a(_data.data() + entry.offset, entry.size, hash);
+            }
+
+            return hash;
+        }
+
+    private:
+        template<typename T>
+        inline SpecializationConstants& SetBytes(uint32_t id, T value)
+        {
+            auto it = std::lower_bound(_entries.begin(), _entries.end(), id, [](const VkSpecializationMapEntry& entry, uint32_t id)
+                {
+                    return entry.constantID < id;
+                }
+            );
+
+            if (it != _entries.end() && it->constantID == id && it->size == sizeof(T))
+            {
+                memcpy(_data.data() + it->offset, &value, sizeof(T));
+                return *this;
+            }
+
+            if (it != _entries.end() && it->constantID == id)
+            {
+                it = _entries.erase(it);
+            }
+
+            VkSpecializationMapEntry entry
+            {
+                .constantID = id,
+                .offset = (uint32_t)_data.size(),
+                .size = sizeof(T),
+            };
+
+            _data.resize(_data.size() + sizeof(T));
+            memcpy(_data.data() + entry.offset, &value, sizeof(T));
+            _entries.insert(it, entry);
+
+            return *this;
+        }
+
+    private:
+        std::vector<VkSpecializationMapEntry> _entries;
+        std::vector<uint8_t> _data;
+    };
+}
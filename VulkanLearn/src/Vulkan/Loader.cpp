@@ -39,87 +39,112 @@ namespace Vulkan::Loader
             return {};
         }
 
-        std::vector<std::shared_ptr<MeshAsset>> meshes;
-
-        std::vector<uint32_t> indices;
-        std::vector<Vertex> vertices;
-
-        for (fastgltf::Mesh& mesh : gltf.meshes) {
-            MeshAsset newmesh;
-            newmesh.Name = mesh.name;
-
-            indices.clear();
-            vertices.clear();
-
-            for (auto&& p : mesh.primitives) {
-                GeoSurface newSurface;
-                newSurface.StartIndex = (uint32_t)indices.size();
-                newSurface.Count = (uint32_t)gltf.accessors[p.indicesAccessor.value()].count;
-
-                size_t initial_vtx = vertices.size();
-
-                Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
-                indices.reserve(indices.size() + indexaccessor.count);
-
-                iterateAccessor<std::uint32_t>(gltf, indexaccessor,
-                    [&](std::uint32_t idx) {
-                        indices.push_back(idx + uint32_t(initial_vtx));
-                    });
-
-                Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
-                vertices.resize(vertices.size() + posAccessor.count);
-
-                iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
-                    [&](glm::vec3 v, size_t index) {
-                        Vertex newvtx
-                        {
-                            .Position = v,
-                            .Uv_x = 0,
-                            .Normal = { 1, 0, 0 },
-                            .Uv_y = 0,
-                            .Color = glm::vec4{ 1.f },
-                        };
-                        vertices[initial_vtx + index] = newvtx;
-                    });
+        struct MeshData
+        {
+            MeshAsset Asset;
+            std::vector<uint32_t> Indices;
+            std::vector<Vertex> Vertices;
+        };
+
+        // Decoding the accessors only reads the asset, every mesh is built on its own job
+        std::vector<MeshData> meshData(gltf.meshes.size());
+
+        engine->Jobs().ParallelFor((uint32_t)gltf.meshes.size(), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t m = begin; m < end; m++) {
+                fastgltf::Mesh& mesh = gltf.meshes[m];
+                MeshAsset& newmesh = meshData[m].Asset;
+                std::vector<uint32_t>& indices = meshData[m].Indices;
+                std::vector<Vertex>& vertices = meshData[m].Vertices;
+
+                newmesh.Name = mesh.name;
+
+                for (auto&& p : mesh.primitives) {
+                    GeoSurface newSurface;
+                    newSurface.StartIndex = (uint32_t)indices.size();
+                    newSurface.Count = (uint32_t)gltf.accessors[p.indicesAccessor.value()].count;
+
+                    size_t initial_vtx = vertices.size();
+
+                    Accessor& indexaccessor = gltf.accessors[p.indicesAccessor.value()];
+                    indices.reserve(indices.size() + indexaccessor.count);
+
+                    iterateAccessor<std::uint32_t>(gltf, indexaccessor,
+                        [&](std::uint32_t idx) {
+                            indices.push_back(idx + uint32_t(initial_vtx));
+                        });
 
-                auto normals = p.findAttribute("NORMAL");
-                if (normals != p.attributes.end()) {
+                    Accessor& posAccessor = gltf.accessors[p.findAttribute("POSITION")->second];
+                    vertices.resize(vertices.size() + posAccessor.count);
 
-                    iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
+                    iterateAccessorWithIndex<glm::vec3>(gltf, posAccessor,
                         [&](glm::vec3 v, size_t index) {
-                            vertices[initial_vtx + index].Normal = v;
+                            Vertex newvtx
+                            {
+                                .Position = v,
+                                .Uv_x = 0,
+                                .Normal = { 1, 0, 0 },
+                                .Uv_y = 0,
+                                .Color = glm::vec4{ 1.f },
+                            };
+                            vertices[initial_vtx + index] = newvtx;
                         });
-                }
-
-                auto uv = p.findAttribute("TEXCOORD_0");
-                if (uv != p.attributes.end()) {
 
-                    iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
-                        [&](glm::vec2 v, size_t index) {
-                            vertices[initial_vtx + index].Uv_x = v.x;
-                            vertices[initial_vtx + index].Uv_y = v.y;
-                        });
+                    auto normals = p.findAttribute("NORMAL");
+                    if (normals != p.attributes.end()) {
+
+                        iterateAccessorWithIndex<glm::vec3>(gltf, gltf.accessors[(*normals).second],
+                            [&](glm::vec3 v, size_t index) {
+                                vertices[initial_vtx + index].Normal = v;
+                            });
+                    }
+
+                    auto uv = p.findAttribute("TEXCOORD_0");
+                    if (uv != p.attributes.end()) {
+
+                        iterateAccessorWithIndex<glm::vec2>(gltf, gltf.accessors[(*uv).second],
+                            [&](glm::vec2 v, size_t index) {
+                                vertices[initial_vtx + index].Uv_x = v.x;
+                                vertices[initial_vtx + index].Uv_y = v.y;
+                            });
+                    }
+
+                    auto colors = p.findAttribute("COLOR_0");
+                    if (colors != p.attributes.end()) {
+
+                        iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
+                            [&](glm::vec4 v, size_t index) {
+                                vertices[initial_vtx + index].Color = v;
+                            });
+                    }
+
+                    glm::vec3 minpos = vertices[initial_vtx].Position;
+                    glm::vec3 maxpos = vertices[initial_vtx].Position;
+                    for (size_t i = initial_vtx; i < vertices.size(); i++) {
+                        minpos = glm::min(minpos, vertices[i].Position);
+                        maxpos = glm::max(maxpos, vertices[i].Position);
+                    }
+
+                    newSurface.Bounds.Origin = (maxpos + minpos) / 2.f;
+                    newSurface.Bounds.Extents = (maxpos - minpos) / 2.f;
+                    newSurface.Bounds.SphereRadius = glm::length(newSurface.Bounds.Extents);
+
+                    newmesh.Surfaces.push_back(newSurface);
                 }
 
-                auto colors = p.findAttribute("COLOR_0");
-                if (colors != p.attributes.end()) {
-
-                    iterateAccessorWithIndex<glm::vec4>(gltf, gltf.accessors[(*colors).second],
-                        [&](glm::vec4 v, size_t index) {
-                            vertices[initial_vtx + index].Color = v;
-                        });
+                constexpr bool OverrideColors = true;
+                if (OverrideColors) {
+                    for (Vertex& vtx : vertices) {
+                        vtx.Color = glm::vec4(vtx.Normal, 1.f);
+                    }
                 }
-                newmesh.Surfaces.push_back(newSurface);
             }
+        });
 
-            constexpr bool OverrideColors = true;
-            if (OverrideColors) {
-                for (Vertex& vtx : vertices) {
-                    vtx.Color = glm::vec4(vtx.Normal, 1.f);
-                }
-            }
-            newmesh.MeshBuffers = engine->UploadMesh(indices, vertices);
-            meshes.emplace_back(std::make_shared<MeshAsset>(std::move(newmesh)));
+        // Uploads share the immediate submit, so they stay on the calling thread
+        std::vector<std::shared_ptr<MeshAsset>> meshes;
+        for (MeshData& data : meshData) {
+            data.Asset.MeshBuffers = engine->UploadMesh(data.Indices, data.Vertices);
+            meshes.emplace_back(std::make_shared<MeshAsset>(std::move(data.Asset)));
         }
 
         return meshes;
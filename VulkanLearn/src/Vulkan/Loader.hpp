@@ -12,10 +12,18 @@ namespace HelloVulkan
 
 namespace Vulkan::Loader
 {
+    struct Bounds
+    {
+        glm::vec3 Origin;
+        glm::vec3 Extents;
+        float SphereRadius;
+    };
+
     struct GeoSurface 
     {
         uint32_t StartIndex;
         uint32_t Count;
+        Bounds Bounds;
     };
 
     struct MeshAsset {
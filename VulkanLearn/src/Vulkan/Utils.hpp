@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdlib>
+
 #include <vk_boostrap/VkBootstrap.h>
 
 #define VK_USE_PLATFORM_WIN32_KHR
@@ -21,6 +23,13 @@ namespace Vulkan
 		uint32_t graphicsQueueFamilyIndex;
 		VkQueue presentQueue;
 		uint32_t presentQueueFamilyIndex;
+		// Dedicated or separate compute family when the device has one, the graphics queue otherwise
+		VkQueue computeQueue;
+		uint32_t computeQueueFamilyIndex;
+		// VK_EXT_graphics_pipeline_library was found and enabled
+		bool graphicsPipelineLibrary;
+		// VK_EXT_shader_object was found and enabled
+		bool shaderObject;
 	};
 
 	inline static BoostrapData boostrapVulkan(GLFWwindow* pWindow, 
@@ -56,11 +65,15 @@ namespace Vulkan
 		VkPhysicalDeviceVulkan12Features features12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
 		features12.bufferDeviceAddress = true;
 		features12.descriptorIndexing = true;
+		features12.timelineSemaphore = true;
+
+		// VL_SOFTWARE_DEVICE lets a CPU implementation like lavapipe run the renderer without a GPU
+		bool softwareDevice = std::getenv("VL_SOFTWARE_DEVICE") != nullptr;
 
 		vkb::PhysicalDeviceSelector selector{ vkb_inst };
 		auto physicalDevice_ret = selector
-			.allow_any_gpu_device_type(false)
-			.prefer_gpu_device_type(vkb::PreferredDeviceType::discrete)
+			.allow_any_gpu_device_type(softwareDevice)
+			.prefer_gpu_device_type(softwareDevice ? vkb::PreferredDeviceType::cpu : vkb::PreferredDeviceType::discrete)
 			.set_minimum_version(1, 3)
 			.set_required_features(features)
 			.set_required_features_13(features13)
@@ -71,6 +84,24 @@ namespace Vulkan
 		vkb::PhysicalDevice vkb_physicalDevice = physicalDevice_ret.value();
 		VkPhysicalDevice physicalDevice = vkb_physicalDevice.physical_device;
 
+		// Optional, pipelines are built monolithically without it
+		VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT graphicsPipelineLibraryFeatures
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+			.graphicsPipelineLibrary = VK_TRUE,
+		};
+		bool graphicsPipelineLibrary = vkb_physicalDevice.enable_extensions_if_present({ VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME })
+			&& vkb_physicalDevice.enable_extension_features_if_present(graphicsPipelineLibraryFeatures);
+
+		// Optional, draws use pipelines without it
+		VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures
+		{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+			.shaderObject = VK_TRUE,
+		};
+		bool shaderObject = vkb_physicalDevice.enable_extension_if_present(VK_EXT_SHADER_OBJECT_EXTENSION_NAME)
+			&& vkb_physicalDevice.enable_extension_features_if_present(shaderObjectFeatures);
+
 		vkb::DeviceBuilder deviceBuilder{ vkb_physicalDevice };
 		auto vkbDevice_ret = deviceBuilder.build();
 
@@ -89,6 +120,23 @@ namespace Vulkan
 		auto presentQueueFamily_ret = vkb_device.get_queue_index(vkb::QueueType::present);
 		uint32_t presentQueueFamilyIndex = presentQueueFamily_ret.value();
 
+		VkQueue computeQueue = graphicsQueue;
+		uint32_t computeQueueFamilyIndex = graphicsQueueFamilyIndex;
+
+		auto computeQueue_ret = vkb_device.get_dedicated_queue(vkb::QueueType::compute);
+		auto computeQueueFamily_ret = vkb_device.get_dedicated_queue_index(vkb::QueueType::compute);
+		if (!computeQueue_ret)
+		{
+			computeQueue_ret = vkb_device.get_queue(vkb::QueueType::compute);
+			computeQueueFamily_ret = vkb_device.get_queue_index(vkb::QueueType::compute);
+		}
+
+		if (computeQueue_ret && computeQueueFamily_ret)
+		{
+			computeQueue = computeQueue_ret.value();
+			computeQueueFamilyIndex = computeQueueFamily_ret.value();
+		}
+
 		return
 		{
 			.instance = instance,
@@ -99,7 +147,11 @@ namespace Vulkan
 			.graphicsQueue = graphicsQueue,
 			.graphicsQueueFamilyIndex = graphicsQueueFamilyIndex,
 			.presentQueue = presentQueue,
-			.presentQueueFamilyIndex = presentQueueFamilyIndex
+			.presentQueueFamilyIndex = presentQueueFamilyIndex,
+			.computeQueue = computeQueue,
+			.computeQueueFamilyIndex = computeQueueFamilyIndex,
+			.graphicsPipelineLibrary = graphicsPipelineLibrary,
+			.shaderObject = shaderObject
 		};
 	}
 
@@ -117,6 +169,7 @@ namespace Vulkan
 		VkSwapchainKHR swapchain;
 		VkFormat imageFormat;
 		VkExtent2D extent;
+		VkPresentModeKHR presentMode;
 		std::vector<VkImage> images;
 		std::vector<VkImageView> imageViews;
 	};
@@ -126,7 +179,9 @@ namespace Vulkan
 		uint32_t height,
 		VkPhysicalDevice physicalDevice,
 		VkDevice logicalDevice,
-		VkSurfaceKHR surface)
+		VkSurfaceKHR surface,
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR,
+		VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE)
 	{
 		vkb::SwapchainBuilder swapchainBuilder{ physicalDevice, logicalDevice, surface };
 
@@ -138,10 +193,14 @@ namespace Vulkan
 
 		auto swapchain_ret = swapchainBuilder
 			.set_desired_format(desiredFormat)
-			.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
-			.set_desired_min_image_count(3)
+			.set_desired_present_mode(presentMode)
+			.add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
+			.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_RELAXED_KHR)
+			.add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR)
+			// Mailbox needs a spare image to replace, the rest queue less frames with two
+			.set_desired_min_image_count(presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2)
 			.set_desired_extent(width, height)
-			.add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+			.set_old_swapchain(oldSwapchain)
 			.build();
 
 		vkb::Swapchain vkb_swapchain = swapchain_ret.value();
@@ -155,6 +214,7 @@ namespace Vulkan
 			.swapchain = swapchain,
 			.imageFormat = vkb_swapchain.image_format,
 			.extent = vkb_swapchain.extent,
+			.presentMode = vkb_swapchain.present_mode,
 			.images = images,
 			.imageViews = imageViews
 		};
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <spdlog/spdlog.h>
 
 #include "HelloVulkan/App.hpp"
@@ -7,6 +8,21 @@ int main(int argc, char** argv) {
     spdlog::set_pattern("[thread %t] [%H:%M:%S] [%^%L%$] %v");
     spdlog::set_level(spdlog::level::debug);
 
+    // Build step: VulkanLearn --cook [output]
+    if (argc >= 2 && strcmp(argv[1], "--cook") == 0)
+    {
+        try
+        {
+            const char* output = argc >= 3 ? argv[2] : HelloVulkan::App::SHADER_BUNDLE_PATH;
+            return HelloVulkan::App::CookShaders(output) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        catch (const std::exception& e)
+        {
+            spdlog::critical(e.what());
+            return EXIT_FAILURE;
+        }
+    }
+
     HelloVulkan::App app;
 
     try 